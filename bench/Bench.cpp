@@ -0,0 +1,269 @@
+#include "Bench.h"
+#include "flat_container/memory_stats.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <new>
+
+namespace bench {
+
+static std::atomic<size_t> g_alloc_bytes{ 0 };
+static std::atomic<size_t> g_alloc_count{ 0 };
+
+static inline void CountAlloc(size_t size)
+{
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+AllocStats GetAllocStats()
+{
+    return { g_alloc_bytes.load(std::memory_order_relaxed), g_alloc_count.load(std::memory_order_relaxed) };
+}
+
+} // namespace bench
+
+
+// ist containers allocate with malloc() / realloc(), so hooking operator new is not enough.
+// on glibc, malloc family is interposed and forwarded to the __libc_ entry points.
+// realloc() is counted as an allocation of the new size.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__EMSCRIPTEN__)
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* addr, size_t size);
+void __libc_free(void* addr);
+
+void* malloc(size_t size)
+{
+    bench::CountAlloc(size);
+    return __libc_malloc(size);
+}
+void* calloc(size_t n, size_t size)
+{
+    bench::CountAlloc(n * size);
+    return __libc_calloc(n, size);
+}
+void* realloc(void* addr, size_t size)
+{
+    bench::CountAlloc(size);
+    return __libc_realloc(addr, size);
+}
+void free(void* addr)
+{
+    __libc_free(addr);
+}
+} // extern "C"
+
+#elif !defined(__SANITIZE_ADDRESS__)
+
+void* operator new(size_t size)
+{
+    bench::CountAlloc(size);
+    if (void* r = std::malloc(size)) {
+        return r;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* addr) noexcept { std::free(addr); }
+void operator delete(void* addr, size_t) noexcept { std::free(addr); }
+
+#endif
+
+
+namespace bench {
+
+uint64_t Now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct CaseEntry
+{
+    std::string name;
+    std::function<void()> body;
+};
+
+static std::vector<CaseEntry>& GetCases()
+{
+    static std::vector<CaseEntry> s_instance;
+    return s_instance;
+}
+
+static Options& GetOptionsImpl()
+{
+    static Options s_instance;
+    return s_instance;
+}
+
+static std::vector<Result>& GetResultsImpl()
+{
+    static std::vector<Result> s_instance;
+    return s_instance;
+}
+
+void RegisterCase(const char* name, const std::function<void()>& body)
+{
+    GetCases().push_back({ name, body });
+}
+
+const Options& GetOptions() { return GetOptionsImpl(); }
+const std::vector<Result>& GetResults() { return GetResultsImpl(); }
+
+std::vector<size_t> Sizes(size_t limit)
+{
+    static const size_t s_sizes[] = { 8, 64, 512, 4096, 32768, 262144, 2097152, 10000000 };
+    limit = std::min(limit, GetOptions().max_size);
+
+    std::vector<size_t> ret;
+    for (size_t s : s_sizes) {
+        if (s <= limit) {
+            ret.push_back(s);
+        }
+    }
+    return ret;
+}
+
+bool IsEnabled(const std::string& name)
+{
+    auto& filter = GetOptions().filter;
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void AddResult(Result&& r)
+{
+    printf("    %-48s %10zu: %12.2fns/op  median %10.3fms  p99 %10.3fms  %12zu bytes  %8zu allocs\n",
+        r.name.c_str(), r.size, r.ns_per_op, r.median_ns / 1e6, r.p99_ns / 1e6, r.bytes_allocated, r.allocations);
+    fflush(stdout);
+    GetResultsImpl().push_back(std::move(r));
+}
+
+static std::string EscapeJson(const std::string& s)
+{
+    std::string ret;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+        }
+        ret += c;
+    }
+    return ret;
+}
+
+static bool WriteJson(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    auto& opt = GetOptions();
+    const char* compiler =
+#if defined(__clang__)
+        "clang " __clang_version__;
+#elif defined(__GNUC__)
+        "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        "msvc";
+#else
+        "unknown";
+#endif
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+
+    fprintf(f, "{\n  \"context\": {\"compiler\": \"%s\", \"build\": \"%s\", \"threads\": %u, \"warmup\": %d, \"reps\": %d, \"max_size\": %zu},\n",
+        EscapeJson(compiler).c_str(), build, std::thread::hardware_concurrency(), opt.warmup, opt.reps, opt.max_size);
+    fprintf(f, "  \"benchmarks\": [");
+    auto& results = GetResults();
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& r = results[i];
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"size\": %zu, \"ops\": %zu, \"reps\": %d, \"median_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, \"ns_per_op\": %.3f, \"bytes_allocated\": %zu, \"allocations\": %zu}",
+            i ? "," : "", EscapeJson(r.name).c_str(), r.size, r.ops, r.reps, r.median_ns, r.p99_ns, r.min_ns, r.ns_per_op, r.bytes_allocated, r.allocations);
+    }
+    fprintf(f, "\n  ],\n  \"memory_stats\": [");
+
+    // empty unless built with FC_ENABLE_MEMORY_STATS
+    bool first = true;
+    ist::for_each_memory_stats([&](std::string_view type, const ist::memory_stats& st) {
+        fprintf(f, "%s\n    {\"type\": \"%s\", \"allocations\": %zu, \"deallocations\": %zu, \"reallocations\": %zu, \"reallocation_moves\": %zu, \"reallocation_copies\": %zu, \"moved_elements\": %zu, \"moved_bytes\": %zu, \"sbo_spills\": %zu, \"bytes_requested\": %zu, \"peak_bytes\": %zu}",
+            first ? "" : ",", EscapeJson(std::string(type)).c_str(), st.allocations, st.deallocations, st.reallocations, st.reallocation_moves,
+            st.reallocation_copies, st.moved_elements, st.moved_bytes, st.sbo_spills, st.bytes_requested, st.peak_bytes);
+        first = false;
+    });
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+static void PrintMemoryStats()
+{
+    bool first = true;
+    ist::for_each_memory_stats([&](std::string_view type, const ist::memory_stats& st) {
+        if (first) {
+            printf("memory stats\n");
+            first = false;
+        }
+        printf("    %-48.*s %10zu allocs %10zu reallocs %10zu copies %12zu moved elements %8zu spills %12zu peak bytes\n",
+            (int)type.size(), type.data(), st.allocations, st.reallocations, st.reallocation_copies, st.moved_elements, st.sbo_spills, st.peak_bytes);
+    });
+}
+
+static void RunCase(const CaseEntry& v)
+{
+    printf("%s begin\n", v.name.c_str());
+    auto begin = Now();
+    v.body();
+    auto end = Now();
+    printf("%s end (%.2fms)\n\n", v.name.c_str(), double(end - begin) / 1e6);
+    fflush(stdout);
+}
+
+} // namespace bench
+
+int main(int argc, char* argv[])
+{
+    auto& opt = bench::GetOptionsImpl();
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i) {
+        if (char* sep = std::strstr(argv[i], "=")) {
+            std::string name(argv[i], sep);
+            const char* value = sep + 1;
+            if (name == "filter")
+                opt.filter = value;
+            else if (name == "warmup")
+                opt.warmup = std::atoi(value);
+            else if (name == "reps")
+                opt.reps = std::max(std::atoi(value), 1);
+            else if (name == "max_size")
+                opt.max_size = std::strtoull(value, nullptr, 10);
+            else if (name == "json")
+                opt.json = value;
+        }
+        else {
+            names.push_back(argv[i]);
+        }
+    }
+
+    for (auto& entry : bench::GetCases()) {
+        if (names.empty() || std::find(names.begin(), names.end(), entry.name) != names.end()) {
+            bench::RunCase(entry);
+        }
+    }
+
+    bench::PrintMemoryStats();
+
+    if (!opt.json.empty()) {
+        if (!bench::WriteJson(opt.json)) {
+            printf("failed to write %s\n", opt.json.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
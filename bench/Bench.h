@@ -0,0 +1,150 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+// benchmark registry.
+// benchCase() registers a function that calls bench::Measure() for each variant and size.
+// each measurement runs warmup + reps times and records median / p99 / min of the timed body,
+// ns per operation, and bytes & count of allocations per run.
+//
+// command line (same style as Test):
+//   Bench [case names...] [filter=substring] [reps=N] [warmup=N] [max_size=N] [json=path]
+// max_size defaults to 1000000. max_size=10000000 runs the full range.
+
+#define benchRegisterCase(Name)\
+    static struct _BenchCase_##Name {\
+        _BenchCase_##Name() { ::bench::RegisterCase(#Name, Name); }\
+    } g_BenchCase_##Name;
+
+#define benchCase(Name) void Name(); benchRegisterCase(Name); void Name()
+
+
+namespace bench {
+
+struct Result
+{
+    std::string name;           // e.g. "flat_map<int,int>/find"
+    size_t size = 0;            // number of elements in the container
+    size_t ops = 0;             // operations per run
+    int reps = 0;
+    double median_ns = 0;       // per run
+    double p99_ns = 0;          // per run
+    double min_ns = 0;          // per run
+    double ns_per_op = 0;       // median_ns / ops
+    size_t bytes_allocated = 0; // per run. total of requested sizes, not peak
+    size_t allocations = 0;     // per run
+};
+
+struct Options
+{
+    std::string filter;
+    int warmup = 1;
+    int reps = 10;
+    size_t max_size = 1000000;
+    std::string json;
+};
+
+void RegisterCase(const char* name, const std::function<void()>& body);
+const Options& GetOptions();
+const std::vector<Result>& GetResults();
+
+// 8, 64, 512 ... up to max_size (and limit), and 10^7 if allowed.
+std::vector<size_t> Sizes(size_t limit = ~size_t(0));
+
+uint64_t Now();
+
+// allocation counters. counts malloc family on glibc, operator new elsewhere.
+struct AllocStats
+{
+    size_t bytes = 0;
+    size_t count = 0;
+};
+AllocStats GetAllocStats();
+
+void AddResult(Result&& r);
+bool IsEnabled(const std::string& name);
+
+// deterministic pseudo random numbers. (xorshift64)
+struct Random
+{
+    uint64_t state;
+
+    explicit Random(uint64_t seed = 0x9E3779B97F4A7C15ull) : state(seed) {}
+    uint64_t operator()()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+    // [0, n)
+    size_t operator()(size_t n) { return size_t((*this)() % n); }
+};
+
+// keeps the compiler from optimizing v away.
+template<class T>
+inline void Consume(const T& v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(v) : "memory");
+#else
+    static volatile const void* s_sink;
+    s_sink = &v;
+#endif
+}
+
+// setup() runs before each run and is not timed. body() is timed, and performs ops operations.
+template<class Setup, class Body>
+inline void Measure(const std::string& name, size_t size, size_t ops, Setup&& setup, Body&& body)
+{
+    if (!IsEnabled(name)) {
+        return;
+    }
+    auto& opt = GetOptions();
+    for (int i = 0; i < opt.warmup; ++i) {
+        setup();
+        body();
+    }
+
+    std::vector<double> times;
+    AllocStats alloc{};
+    for (int i = 0; i < opt.reps; ++i) {
+        setup();
+        AllocStats a0 = GetAllocStats();
+        uint64_t t0 = Now();
+        body();
+        uint64_t t1 = Now();
+        AllocStats a1 = GetAllocStats();
+        times.push_back(double(t1 - t0));
+        alloc.bytes += a1.bytes - a0.bytes;
+        alloc.count += a1.count - a0.count;
+    }
+
+    Result r;
+    r.name = name;
+    r.size = size;
+    r.ops = ops;
+    r.reps = opt.reps;
+    if (!times.empty()) {
+        std::sort(times.begin(), times.end());
+        r.median_ns = times[times.size() / 2];
+        r.p99_ns = times[std::min(times.size() - 1, (times.size() * 99 + 99) / 100 - 1)];
+        r.min_ns = times.front();
+        r.ns_per_op = ops ? r.median_ns / ops : 0;
+        r.bytes_allocated = alloc.bytes / times.size();
+        r.allocations = alloc.count / times.size();
+    }
+    AddResult(std::move(r));
+}
+
+template<class Body>
+inline void Measure(const std::string& name, size_t size, size_t ops, Body&& body)
+{
+    Measure(name, size, ops, []() {}, std::forward<Body>(body));
+}
+
+} // namespace bench
@@ -0,0 +1,303 @@
+#include "Bench.h"
+#include "flat_container/flat_map.h"
+#include "flat_container/flat_set.h"
+#include "flat_container/flat_hash_map.h"
+#include "flat_container/frozen_map.h"
+#include "flat_container/set_operations.h"
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <iterator>
+
+namespace {
+
+constexpr size_t find_ops = 100000;
+constexpr size_t erase_ops = 64;
+// single inserts into sorted vectors are O(n). larger sizes are covered by insert_range.
+constexpr size_t flat_insert_max_size = 32768;
+constexpr size_t lower_bound_ops = 65536;
+
+template<class C>
+constexpr bool is_map_v = requires { typename C::mapped_type; };
+
+template<class C>
+constexpr bool is_flat_v = false;
+template<class K, class V, class Cmp, class Container>
+constexpr bool is_flat_v<ist::basic_map<K, V, Cmp, Container>> = true;
+template<class K, class Cmp, class Container>
+constexpr bool is_flat_v<ist::basic_set<K, Cmp, Container>> = true;
+
+// distinct keys in random order
+std::vector<int> MakeKeys(size_t size)
+{
+    std::vector<int> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = int(i * 2);
+    }
+    bench::Random rand;
+    for (size_t i = size; i > 1; --i) {
+        std::swap(keys[i - 1], keys[rand(i)]);
+    }
+    return keys;
+}
+
+template<class C>
+auto MakeValues(const std::vector<int>& keys)
+{
+    if constexpr (is_map_v<C>) {
+        std::vector<typename C::value_type> values;
+        values.reserve(keys.size());
+        for (int k : keys) {
+            values.push_back({ k, k });
+        }
+        return values;
+    }
+    else {
+        return keys;
+    }
+}
+
+template<class C>
+void BenchMap(const char* type_name)
+{
+    std::string name = type_name;
+    for (size_t size : bench::Sizes()) {
+        auto keys = MakeKeys(size);
+        auto values = MakeValues<C>(keys);
+        std::unique_ptr<C> c;
+
+        if (!is_flat_v<C> || size <= flat_insert_max_size) {
+            bench::Measure(name + "/insert", size, size,
+                [&]() { c = std::make_unique<C>(); },
+                [&]() {
+                    for (auto& v : values) {
+                        c->insert(v);
+                    }
+                    bench::Consume(c->size());
+                });
+        }
+        bench::Measure(name + "/insert_range", size, size,
+            [&]() { c = std::make_unique<C>(); },
+            [&]() {
+                c->insert(values.begin(), values.end());
+                bench::Consume(c->size());
+            });
+
+        // c holds all keys after insert_range.
+        bench::Measure(name + "/find", size, find_ops,
+            [&]() {
+                bench::Random rand;
+                size_t hits = 0;
+                for (size_t i = 0; i < find_ops; ++i) {
+                    hits += c->find(keys[rand(size)]) != c->end();
+                }
+                bench::Consume(hits);
+            });
+
+        if constexpr (is_flat_v<C>) {
+            std::vector<int> queries(find_ops);
+            bench::Random rand;
+            for (auto& q : queries) {
+                q = keys[rand(size)];
+            }
+            std::vector<typename C::const_iterator> results(find_ops);
+            auto& cc = std::as_const(*c);
+            auto count_hits = [&]() {
+                size_t hits = 0;
+                for (auto& r : results) {
+                    hits += r != cc.end();
+                }
+                bench::Consume(hits);
+            };
+            bench::Measure(name + "/find_many", size, find_ops,
+                [&]() {
+                    cc.find_many(queries, results.begin());
+                    count_hits();
+                });
+            std::sort(queries.begin(), queries.end());
+            bench::Measure(name + "/find_many_sorted", size, find_ops,
+                [&]() {
+                    cc.find_many(queries, results.begin());
+                    count_hits();
+                });
+        }
+
+        // erased keys are restored by setup() of the next run.
+        size_t n = std::min(size, erase_ops);
+        bench::Measure(name + "/erase", size, n,
+            [&]() { c->insert(values.begin(), values.begin() + n); },
+            [&]() {
+                for (size_t i = 0; i < n; ++i) {
+                    c->erase(keys[i]);
+                }
+                bench::Consume(c->size());
+            });
+    }
+}
+
+// random keys, and queries that all hit
+template<class Map>
+void BenchFind(const char* type_name, const std::vector<std::pair<const uint64_t, uint64_t>>& pairs, const std::vector<uint64_t>& queries)
+{
+    Map map(pairs.begin(), pairs.end());
+    bench::Measure(std::string(type_name) + "/find", map.size(), queries.size(),
+        [&]() {
+            uint64_t total = 0;
+            for (auto q : queries) {
+                total += map.find(q)->second;
+            }
+            bench::Consume(total);
+        });
+}
+
+template<class T>
+void BenchLowerBound(const char* type_name)
+{
+    std::string name = type_name;
+    for (size_t n : { 4, 8, 16, 32, 48, 64, 96, 128 }) {
+        std::vector<T> keys;
+        for (size_t i = 0; i < n; ++i) {
+            keys.push_back(T(i * 2));
+        }
+        std::vector<T> queries(lower_bound_ops);
+        bench::Random rand;
+        for (auto& q : queries) {
+            q = T(rand(n * 2));
+        }
+
+        bench::Measure("std::lower_bound<" + name + ">", n, lower_bound_ops,
+            [&]() {
+                size_t total = 0;
+                for (auto q : queries) {
+                    total += std::lower_bound(keys.begin(), keys.end(), q) - keys.begin();
+                }
+                bench::Consume(total);
+            });
+        bench::Measure("ist::_linear_lower_bound<" + name + ">", n, lower_bound_ops,
+            [&]() {
+                size_t total = 0;
+                for (auto q : queries) {
+                    total += ist::_linear_lower_bound(keys.data(), keys.size(), q);
+                }
+                bench::Consume(total);
+            });
+    }
+}
+
+} // namespace
+
+benchCase(bench_map)
+{
+    BenchMap<std::map<int, int>>("std::map<int,int>");
+    BenchMap<std::unordered_map<int, int>>("std::unordered_map<int,int>");
+    BenchMap<ist::flat_map<int, int>>("ist::flat_map<int,int>");
+    BenchMap<ist::flat_hash_map<int, int>>("ist::flat_hash_map<int,int>");
+}
+
+benchCase(bench_set)
+{
+    BenchMap<std::set<int>>("std::set<int>");
+    BenchMap<ist::flat_set<int>>("ist::flat_set<int>");
+}
+
+benchCase(bench_frozen_map)
+{
+    for (size_t size : bench::Sizes()) {
+        bench::Random rand;
+        std::vector<std::pair<const uint64_t, uint64_t>> pairs;
+        for (size_t i = 0; i < size; ++i) {
+            pairs.push_back({ rand(), i });
+        }
+        std::vector<uint64_t> queries(find_ops);
+        for (auto& q : queries) {
+            q = pairs[rand(size)].first;
+        }
+        BenchFind<ist::flat_map<uint64_t, uint64_t>>("ist::flat_map<uint64_t,uint64_t>", pairs, queries);
+        BenchFind<ist::frozen_map<uint64_t, uint64_t>>("ist::frozen_map<uint64_t,uint64_t>", pairs, queries);
+    }
+}
+
+// crossover point of linear search and binary search. (FC_LINEAR_SEARCH_THRESHOLD)
+benchCase(bench_linear_search)
+{
+    BenchLowerBound<int32_t>("int32_t");
+    BenchLowerBound<uint64_t>("uint64_t");
+    BenchLowerBound<double>("double");
+}
+
+// construction from unsorted pairs. large ranges are sorted & merged in parallel.
+benchCase(bench_parallel_sort)
+{
+    size_t prev = ist::get_parallel_threads();
+    for (size_t size : bench::Sizes()) {
+        if (size < 262144) {
+            continue;
+        }
+        bench::Random rand;
+        std::vector<std::pair<const uint64_t, uint64_t>> pairs;
+        for (size_t i = 0; i < size; ++i) {
+            pairs.push_back({ rand(), rand() });
+        }
+        for (size_t threads : { 1, 2, 4, 8 }) {
+            ist::set_parallel_threads(threads);
+            bench::Measure("ist::flat_map<uint64_t,uint64_t>/construct/threads=" + std::to_string(threads), size, size,
+                [&]() {
+                    ist::flat_map<uint64_t, uint64_t> map(pairs.begin(), pairs.end());
+                    bench::Consume(map.size());
+                });
+        }
+    }
+    ist::set_parallel_threads(prev);
+}
+
+// posting lists: sorted document ids. size is |a|, and |b| is size / ratio.
+benchCase(bench_set_operations)
+{
+    auto make = [](size_t n, size_t range, uint64_t seed) {
+        bench::Random rand(seed);
+        std::vector<uint64_t> v(n);
+        for (auto& e : v) {
+            e = rand(range);
+        }
+        return ist::flat_set<uint64_t>(v.begin(), v.end());
+    };
+    for (size_t size : bench::Sizes()) {
+        for (size_t ratio : { 1, 10, 1000 }) {
+            if (size / ratio == 0) {
+                continue;
+            }
+            auto a = make(size, size * 4, 1);
+            auto b = make(size / ratio, size * 4, 2);
+            std::string suffix = "/ratio=" + std::to_string(ratio);
+            ist::flat_set<uint64_t> r;
+
+            bench::Measure("std::set_intersection" + suffix, size, a.size() + b.size(),
+                [&]() {
+                    std::vector<uint64_t> tmp;
+                    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(tmp));
+                    r = ist::flat_set<uint64_t>(ist::sorted_unique, std::move(tmp));
+                    bench::Consume(r.size());
+                });
+            bench::Measure("ist::set_intersection" + suffix, size, a.size() + b.size(),
+                [&]() {
+                    ist::set_intersection(a, b, r);
+                    bench::Consume(r.size());
+                });
+            bench::Measure("std::set_union" + suffix, size, a.size() + b.size(),
+                [&]() {
+                    std::vector<uint64_t> tmp;
+                    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(tmp));
+                    r = ist::flat_set<uint64_t>(ist::sorted_unique, std::move(tmp));
+                    bench::Consume(r.size());
+                });
+            bench::Measure("ist::set_union" + suffix, size, a.size() + b.size(),
+                [&]() {
+                    ist::set_union(a, b, r);
+                    bench::Consume(r.size());
+                });
+        }
+    }
+}
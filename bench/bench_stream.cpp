@@ -0,0 +1,140 @@
+#include "Bench.h"
+#include "flat_container/flat_map.h"
+#include "flat_container/raw_vector.h"
+#include "flat_container/memory_view_stream.h"
+#include "flat_container/snapshot.h"
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+
+benchCase(bench_snapshot)
+{
+    for (size_t size : bench::Sizes(4194304)) {
+        std::vector<std::pair<const uint64_t, uint64_t>> pairs;
+        for (size_t i = 0; i < size; ++i) {
+            pairs.push_back({ uint64_t(i) * 0x9e3779b97f4a7c15ull, i });
+        }
+        ist::flat_map<uint64_t, uint64_t> map(pairs.begin(), pairs.end());
+        ist::raw_vector<char> buf(ist::snapshot_size(map));
+        ist::write_snapshot(map, buf.data(), buf.size());
+
+        bench::Measure("ist::flat_map<uint64_t,uint64_t>/rebuild", size, size,
+            [&]() {
+                ist::flat_map<uint64_t, uint64_t> tmp(pairs.begin(), pairs.end());
+                bench::Consume(tmp.size());
+            });
+        bench::Measure("load_snapshot/checksum", size, size,
+            [&]() {
+                auto view = ist::load_snapshot<ist::mapped_map<uint64_t, uint64_t>>(buf.data(), buf.size());
+                bench::Consume(view.size());
+            });
+        bench::Measure("load_snapshot/no_checksum", size, size,
+            [&]() {
+                auto view = ist::load_snapshot<ist::mapped_map<uint64_t, uint64_t>>(buf.data(), buf.size(), false);
+                bench::Consume(view.size());
+            });
+    }
+}
+
+// size is the number of uint64_t values read or written.
+benchCase(bench_memory_view_reader)
+{
+    for (size_t size : bench::Sizes(16777216)) {
+        ist::raw_vector<uint64_t> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = i;
+        }
+        ist::raw_vector<char> out(size * sizeof(uint64_t));
+
+        bench::Measure("memory_view_stream/read", size, size,
+            [&]() {
+                ist::memory_view_stream stream(data.data(), data.size_bytes());
+                uint64_t total = 0;
+                for (size_t i = 0; i < size; ++i) {
+                    uint64_t t;
+                    stream.read((char*)&t, sizeof(t));
+                    total += t;
+                }
+                bench::Consume(total);
+            });
+        bench::Measure("memory_view_reader/read", size, size,
+            [&]() {
+                ist::memory_view_stream stream(data.data(), data.size_bytes());
+                ist::memory_view_reader reader(stream);
+                uint64_t total = 0;
+                for (size_t i = 0; i < size; ++i) {
+                    total += reader.read<uint64_t>();
+                }
+                bench::Consume(total);
+            });
+        bench::Measure("memory_view_stream/write", size, size,
+            [&]() {
+                ist::memory_view_stream stream(out.data(), out.size());
+                for (size_t i = 0; i < size; ++i) {
+                    stream.write((const char*)&data[i], sizeof(uint64_t));
+                }
+                bench::Consume(out.data());
+            });
+        bench::Measure("memory_view_writer/write", size, size,
+            [&]() {
+                ist::memory_view_stream stream(out.data(), out.size());
+                ist::memory_view_writer writer(stream);
+                for (size_t i = 0; i < size; ++i) {
+                    writer.write(data[i]);
+                }
+                bench::Consume(out.data());
+            });
+    }
+}
+
+// simulate I/O latency and parsing cost. async mode overlaps them. size is the number of chunks.
+benchCase(bench_async_prefetch)
+{
+    const size_t chunk_size = 64 * 1024;
+    const auto latency = std::chrono::milliseconds(2);
+
+    auto source = [&](size_t num_chunks) {
+        return [num_chunks, latency, count = size_t(0)](char* dst, size_t size) mutable -> size_t {
+            if (count++ == num_chunks) {
+                return 0;
+            }
+            std::this_thread::sleep_for(latency);
+            std::memset(dst, 1, size);
+            return size;
+        };
+    };
+    auto parse = [&](ist::memory_view_stream& stream, size_t num_chunks) {
+        ist::memory_view_reader reader(stream);
+        uint64_t total = 0;
+        for (size_t i = 0; i < num_chunks * chunk_size; ++i) {
+            total += reader.read<uint8_t>();
+            if (i % chunk_size == 0) {
+                std::this_thread::sleep_for(latency);
+            }
+        }
+        bench::Consume(total);
+    };
+
+    for (size_t num_chunks : { 8, 64 }) {
+        bench::Measure("memory_view_stream/underflow_handler", num_chunks, num_chunks,
+            [&]() {
+                auto src = source(num_chunks);
+                std::vector<char> buf(chunk_size);
+                ist::memory_view_stream stream;
+                stream.set_underflow_handler([&](char*& data, size_t& size, char*& cur) -> bool {
+                    size = src(buf.data(), buf.size());
+                    data = cur = buf.data();
+                    return size != 0;
+                    });
+                parse(stream, num_chunks);
+            });
+        bench::Measure("memory_view_stream/start_async_read", num_chunks, num_chunks,
+            [&]() {
+                ist::memory_view_stream stream;
+                stream.start_async_read(source(num_chunks), chunk_size);
+                parse(stream, num_chunks);
+            });
+    }
+}
@@ -0,0 +1,285 @@
+#include "Bench.h"
+#include "flat_container/string.h"
+#include "flat_container/flat_map.h"
+#include "flat_container/string_pool.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdio>
+
+namespace {
+
+constexpr size_t copy_ops = 1000;
+constexpr size_t search_ops = 100;
+
+std::string MakeText(size_t size)
+{
+    std::string text(size, ' ');
+    bench::Random rand;
+    for (auto& c : text) {
+        c = char('a' + rand(26));
+    }
+    return text;
+}
+
+// size is the string length in all measurements.
+template<class String>
+void BenchString(const char* type_name)
+{
+    std::string name = type_name;
+    for (size_t size : bench::Sizes(262144)) {
+        std::string text = MakeText(size);
+        String str(text.data(), text.size());
+        String str2 = str;
+
+        bench::Measure(name + "/construct", size, copy_ops,
+            [&]() {
+                for (size_t i = 0; i < copy_ops; ++i) {
+                    String s(text.data(), size);
+                    bench::Consume(s.data());
+                }
+            });
+        bench::Measure(name + "/copy", size, copy_ops,
+            [&]() {
+                for (size_t i = 0; i < copy_ops; ++i) {
+                    String s = str;
+                    bench::Consume(s.data());
+                }
+            });
+        bench::Measure(name + "/append", size, size,
+            [&]() {
+                String s;
+                for (size_t i = 0; i < size; ++i) {
+                    s += text[i];
+                }
+                bench::Consume(s.data());
+            });
+
+        // needles are absent, so each search scans the whole string. pos varies so that searches are not hoisted.
+        bench::Measure(name + "/find", size, search_ops,
+            [&]() {
+                size_t r = 0;
+                for (size_t i = 0; i < search_ops; ++i) {
+                    r += str.find("abcdefghijklmnop", i & 1);
+                }
+                bench::Consume(r);
+            });
+        bench::Measure(name + "/find_first_of", size, search_ops,
+            [&]() {
+                size_t r = 0;
+                for (size_t i = 0; i < search_ops; ++i) {
+                    r += str.find_first_of(" \t\r\n;", i & 1);
+                }
+                bench::Consume(r);
+            });
+        bench::Measure(name + "/compare", size, copy_ops,
+            [&]() {
+                int r = 0;
+                for (size_t i = 0; i < copy_ops; ++i) {
+                    bench::Consume(str2);
+                    r += str.compare(str2);
+                }
+                bench::Consume(r);
+            });
+    }
+}
+
+// short keys. compact_string makes elements smaller, and the map grows by realloc().
+template<class String>
+void BenchStringKeyMap(const char* type_name, const std::vector<std::string>& keys)
+{
+    std::string name = type_name;
+    size_t size = keys.size();
+    std::vector<std::pair<const String, int>> pairs;
+    for (size_t i = 0; i < size; ++i) {
+        pairs.emplace_back(String(keys[i]), int(i));
+    }
+    ist::flat_map<String, int> map;
+
+    bench::Measure(name + "/insert_range", size, size,
+        [&]() { map.clear(); },
+        [&]() {
+            map.insert(pairs.begin(), pairs.end());
+            bench::Consume(map.size());
+        });
+    bench::Measure(name + "/find", size, size,
+        [&]() {
+            size_t hits = 0;
+            for (auto& k : keys) {
+                hits += map.find(String(k)) != map.end();
+            }
+            bench::Consume(hits);
+        });
+}
+
+} // namespace
+
+benchCase(bench_string)
+{
+    BenchString<std::string>("std::string");
+    BenchString<ist::string>("ist::string");
+    BenchString<ist::compact_string<>>("ist::compact_string<24>");
+}
+
+// tokenize long lines
+benchCase(bench_find_first_of)
+{
+    for (size_t size : bench::Sizes(2097152)) {
+        bench::Random rand;
+        std::string sstr(size, ' ');
+        for (auto& c : sstr) {
+            c = rand(40) == 0 ? " \t,;"[rand(4)] : char('a' + rand(26));
+        }
+        ist::string istr(sstr.data(), sstr.size());
+        const char* delims = " \t\r\n,;";
+        const char* letters = "abcdefghijklmnopqrstuvwxyz \t,;";
+
+        bench::Measure("std::string/tokenize", size, size,
+            [&]() {
+                size_t count = 0;
+                for (size_t pos = 0; (pos = sstr.find_first_of(delims, pos)) != std::string::npos; ++pos) {
+                    ++count;
+                }
+                bench::Consume(count);
+            });
+        bench::Measure("ist::string/tokenize", size, size,
+            [&]() {
+                size_t count = 0;
+                for (size_t pos = 0; (pos = istr.find_first_of(delims, pos)) != ist::string::npos; ++pos) {
+                    ++count;
+                }
+                bench::Consume(count);
+            });
+        bench::Measure("std::string/find_first_not_of", size, size,
+            [&]() { bench::Consume(sstr.find_first_not_of(letters)); });
+        bench::Measure("ist::string/find_first_not_of", size, size,
+            [&]() { bench::Consume(istr.find_first_not_of(letters)); });
+    }
+}
+
+// text with many first char matches. Traits::find() + Traits::compare() stops at each of them.
+benchCase(bench_find_substr)
+{
+    for (size_t size : bench::Sizes(4194304)) {
+        bench::Random rand;
+        std::string sstr(size, ' ');
+        for (auto& c : sstr) {
+            c = char('a' + rand(4));
+        }
+        ist::string istr(sstr.data(), sstr.size());
+
+        for (size_t nlen : { 8, 32, 128 }) {
+            std::string needle(nlen, ' ');
+            for (auto& c : needle) {
+                c = char('a' + rand(4));
+            }
+            ist::string_searcher searcher(needle);
+            std::string suffix = "/needle=" + std::to_string(nlen);
+
+            // pos varies so that searches are not hoisted
+            bench::Measure("std::string/find" + suffix, size, search_ops,
+                [&]() {
+                    size_t r = 0;
+                    for (size_t i = 0; i < search_ops; ++i) {
+                        r += sstr.find(needle, i & 1);
+                    }
+                    bench::Consume(r);
+                });
+            bench::Measure("ist::string/find" + suffix, size, search_ops,
+                [&]() {
+                    size_t r = 0;
+                    for (size_t i = 0; i < search_ops; ++i) {
+                        r += istr.find(needle.c_str(), i & 1);
+                    }
+                    bench::Consume(r);
+                });
+            bench::Measure("ist::string_searcher/find" + suffix, size, search_ops,
+                [&]() {
+                    size_t r = 0;
+                    for (size_t i = 0; i < search_ops; ++i) {
+                        r += searcher.find(istr, i & 1);
+                    }
+                    bench::Consume(r);
+                });
+        }
+    }
+}
+
+benchCase(bench_compact_string)
+{
+    for (size_t size : bench::Sizes(262144)) {
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < size; ++i) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "key_%012d", int(i * 7919));
+            keys.push_back(buf);
+        }
+        bench::Random rand;
+        for (size_t i = size; i > 1; --i) {
+            std::swap(keys[i - 1], keys[rand(i)]);
+        }
+        BenchStringKeyMap<ist::sbo_string<22>>("ist::flat_map<ist::sbo_string<22>,int>", keys);
+        BenchStringKeyMap<ist::compact_string<24>>("ist::flat_map<ist::compact_string<24>,int>", keys);
+    }
+}
+
+// paths with long common prefixes. string comparison walks the prefix on each step of binary search.
+benchCase(bench_string_pool)
+{
+    const size_t lookup_ops = 100000;
+    for (size_t size : bench::Sizes(262144)) {
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < size; ++i) {
+            keys.push_back("/usr/local/share/application/resources/textures/" + std::to_string(i * 7919));
+        }
+        std::vector<std::string> queries;
+        bench::Random rand;
+        for (size_t i = 0; i < lookup_ops; ++i) {
+            queries.push_back(keys[rand(size)]);
+        }
+
+        std::vector<std::pair<const ist::string, int>> pairs;
+        for (size_t i = 0; i < size; ++i) {
+            pairs.emplace_back(ist::string(keys[i]), int(i));
+        }
+        ist::flat_map<ist::string, int> smap(pairs.begin(), pairs.end());
+        std::vector<ist::string> query_strs(queries.begin(), queries.end());
+
+        ist::string_pool pool;
+        ist::string_pool_scope scope(pool);
+        ist::flat_map<ist::string_pool::id_type, int, ist::interned_less> imap;
+        for (size_t i = 0; i < size; ++i) {
+            imap[pool.intern(keys[i])] = int(i);
+        }
+        std::vector<ist::string_pool::id_type> query_ids;
+        for (auto& q : queries) {
+            query_ids.push_back(pool.find(q));
+        }
+
+        bench::Measure("ist::flat_map<ist::string,int>/find(ist::string)", size, lookup_ops,
+            [&]() {
+                int64_t sum = 0;
+                for (auto& q : query_strs) {
+                    sum += smap.find(q)->second;
+                }
+                bench::Consume(sum);
+            });
+        bench::Measure("ist::flat_map<id_type,int,interned_less>/find(std::string_view)", size, lookup_ops,
+            [&]() {
+                int64_t sum = 0;
+                for (auto& q : queries) {
+                    sum += imap.find(std::string_view(q))->second;
+                }
+                bench::Consume(sum);
+            });
+        bench::Measure("ist::flat_map<id_type,int,interned_less>/find(id)", size, lookup_ops,
+            [&]() {
+                int64_t sum = 0;
+                for (auto id : query_ids) {
+                    sum += imap.find(id)->second;
+                }
+                bench::Consume(sum);
+            });
+    }
+}
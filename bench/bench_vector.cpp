@@ -0,0 +1,105 @@
+#include "Bench.h"
+#include "flat_container/vector.h"
+#include "flat_container/raw_vector.h"
+#include <memory>
+#include <vector>
+#include <cstdio>
+
+namespace {
+
+constexpr size_t fixed_capacity = 1 << 16;
+constexpr size_t insert_ops = 256;
+
+// containers are heap allocated in setup(), so fixed_vector doesn't need a large stack.
+template<class Vector>
+void BenchVector(const char* type_name, size_t max_size)
+{
+    std::string name = type_name;
+    for (size_t size : bench::Sizes(max_size)) {
+        std::unique_ptr<Vector> v;
+
+        bench::Measure(name + "/push_back", size, size,
+            [&]() { v = std::make_unique<Vector>(); },
+            [&]() {
+                for (size_t i = 0; i < size; ++i) {
+                    v->push_back(int(i));
+                }
+                bench::Consume(v->data());
+            });
+
+        auto fill = [&]() {
+            v = std::make_unique<Vector>();
+            for (size_t i = 0; i < size; ++i) {
+                v->push_back(int(i));
+            }
+        };
+        bench::Measure(name + "/insert", size, insert_ops, fill,
+            [&]() {
+                bench::Random rand;
+                for (size_t i = 0; i < insert_ops; ++i) {
+                    v->insert(v->begin() + rand(v->size() + 1), int(i));
+                }
+                bench::Consume(v->data());
+            });
+        bench::Measure(name + "/erase", size, std::min(size, insert_ops), fill,
+            [&]() {
+                bench::Random rand;
+                for (size_t i = 0, n = std::min(size, insert_ops); i < n; ++i) {
+                    v->erase(v->begin() + rand(v->size()));
+                }
+                bench::Consume(v->data());
+            });
+    }
+}
+
+// allocations per run is the number of reallocations. capacity overhead over size is printed separately.
+template<class Vector>
+void BenchGrowth(const char* policy_name)
+{
+    std::string name = std::string(policy_name) + "/push_back";
+    for (size_t size : bench::Sizes(4194304)) {
+        std::unique_ptr<Vector> v;
+        bench::Measure(name, size, size,
+            [&]() { v = std::make_unique<Vector>(); },
+            [&]() {
+                for (size_t i = 0; i < size; ++i) {
+                    v->push_back(uint32_t(i));
+                }
+                bench::Consume(v->data());
+            });
+    }
+
+    // averaged over all sizes in [1, max size]
+    size_t max_size = bench::Sizes(4194304).back();
+    Vector v;
+    double total_overhead = 0;
+    for (size_t i = 0; i < max_size; ++i) {
+        v.push_back(uint32_t(i));
+        total_overhead += double(v.capacity() - v.size()) / double(v.size());
+    }
+    printf("    %-48s average capacity overhead %.1f%%\n", policy_name, total_overhead / max_size * 100.0);
+}
+
+} // namespace
+
+benchCase(bench_vector)
+{
+    // insert / erase at random positions are O(n). 2097152 ints is already 8MB of memmove per op.
+    const size_t max_size = 2097152;
+    BenchVector<std::vector<int>>("std::vector<int>", max_size);
+    BenchVector<ist::vector<int>>("ist::vector<int>", max_size);
+    BenchVector<ist::raw_vector<int>>("ist::raw_vector<int>", max_size);
+    BenchVector<ist::sbo_vector<int, 16>>("ist::sbo_vector<int,16>", max_size);
+    BenchVector<ist::fixed_vector<int, fixed_capacity>>("ist::fixed_vector<int,65536>", fixed_capacity - insert_ops);
+}
+
+benchCase(bench_growth_policy)
+{
+    using namespace ist;
+    BenchGrowth<basic_raw_vector<uint32_t, dynamic_memory<uint32_t, growth_2x>>>("growth_2x");
+    BenchGrowth<basic_raw_vector<uint32_t, dynamic_memory<uint32_t, growth_1_5x>>>("growth_1_5x");
+    BenchGrowth<basic_raw_vector<uint32_t, dynamic_memory<uint32_t, growth_page_round<>>>>("growth_page_round<growth_2x>");
+    BenchGrowth<basic_raw_vector<uint32_t, dynamic_memory<uint32_t, growth_page_round<growth_1_5x>>>>("growth_page_round<growth_1_5x>");
+    BenchGrowth<basic_raw_vector<uint32_t, dynamic_memory<uint32_t, growth_usable_size<>>>>("growth_usable_size<growth_2x>");
+    BenchGrowth<basic_raw_vector<uint32_t, dynamic_memory<uint32_t, growth_fixed<65536>>>>("growth_fixed<65536>");
+}
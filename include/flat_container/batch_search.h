@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+#include "memory.h"
+
+// batch search on sorted arrays. (find_many() / lower_bound_many() of flat_map & flat_set)
+// each step of a binary search on large data waits for a cache miss. a group of searches is run in lock step,
+// and the next probe of each one is prefetched before the group comes back to it, so the misses overlap.
+// sorted keys are searched by a forward sweep instead: each search gallops from the result of the previous one.
+
+namespace ist {
+
+// number of searches run in lock step. enough to hide memory latency, small enough to keep probes in L1.
+constexpr size_t batch_search_group = 16;
+
+// first position in [first, last) that is not less than v, searched from first by doubling steps.
+template<class Iter, class V, class Less>
+inline Iter _gallop_lower_bound(Iter first, Iter last, const V& v, Less& less)
+{
+    size_t n = std::distance(first, last);
+    size_t lo = 0, step = 1;
+    while (lo + step < n && less(first[lo + step], v)) {
+        lo += step;
+        step *= 2;
+    }
+    return std::lower_bound(first + lo, first + std::min(lo + step + 1, n), v, less);
+}
+
+// f(keys[i], lower bound index of keys[i]) for each key in order. less(element, key).
+template<class T, class KeyIter, class Less, class F>
+inline void _lower_bound_many(const T* data, size_t n, KeyIter keys, size_t num_keys, Less& less, F&& f)
+{
+    if (n == 0) {
+        for (size_t i = 0; i < num_keys; ++i) {
+            f(keys[i], 0);
+        }
+        return;
+    }
+
+    size_t base[batch_search_group];
+    for (size_t g = 0; g < num_keys; g += batch_search_group) {
+        KeyIter k = keys + g;
+        size_t m = std::min(batch_search_group, num_keys - g);
+        std::fill_n(base, m, 0);
+        // branchless. all searches of the group have the same length at each step.
+        for (size_t len = n; len > 1; ) {
+            size_t half = len / 2;
+            len -= half;
+            for (size_t i = 0; i < m; ++i) {
+                base[i] += less(data[base[i] + half], k[i]) ? half : 0;
+                fc_prefetch(data + base[i] + len / 2);
+            }
+        }
+        for (size_t i = 0; i < m; ++i) {
+            f(k[i], base[i] + (less(data[base[i]], k[i]) ? 1 : 0));
+        }
+    }
+}
+
+// same as _lower_bound_many() for sorted keys.
+template<class T, class KeyIter, class Less, class F>
+inline void _lower_bound_many_sorted(const T* data, size_t n, KeyIter keys, size_t num_keys, Less& less, F&& f)
+{
+    const T* pos = data;
+    for (size_t i = 0; i < num_keys; ++i) {
+        pos = _gallop_lower_bound(pos, data + n, keys[i], less);
+        f(keys[i], size_t(pos - data));
+    }
+}
+
+} // namespace ist
@@ -0,0 +1,186 @@
+#pragma once
+#include "hash_table.h"
+
+namespace ist {
+
+// open addressing hash map (swiss table style. see hash_table.h)
+// elements are stored in slots of the table directly. no per-element allocation.
+// unlike std::unordered_map, insertion may move elements and invalidate iterators & references.
+template <
+    class Key,
+    class Value,
+    class Hash,
+    class KeyEqual,
+    class Memory
+>
+class basic_hash_map : public basic_hash_table<std::pair<Key, Value>, _hash_key_first, Hash, KeyEqual, Memory>
+{
+using super = basic_hash_table<std::pair<Key, Value>, _hash_key_first, Hash, KeyEqual, Memory>;
+public:
+    using key_type               = Key;
+    using mapped_type            = Value;
+    using value_type             = std::pair<const key_type, mapped_type>;
+    using reference              = value_type&;
+    using const_reference        = const value_type&;
+    using typename super::size_type;
+    using typename super::difference_type;
+    using typename super::hasher;
+    using typename super::key_equal;
+    using typename super::iterator;
+    using typename super::const_iterator;
+
+    basic_hash_map() {}
+    basic_hash_map(const basic_hash_map& v) = default;
+    basic_hash_map(basic_hash_map&& v) noexcept = default;
+    basic_hash_map& operator=(const basic_hash_map& v) = default;
+    basic_hash_map& operator=(basic_hash_map&& v) noexcept = default;
+
+    template <class Iter, bool mapped = is_mapped_memory_v<Memory>, fc_require(!mapped), fc_require(is_iterator_v<Iter, value_type>)>
+    basic_hash_map(Iter first, Iter last)
+    {
+        insert(first, last);
+    }
+    template <bool mapped = is_mapped_memory_v<Memory>, fc_require(!mapped)>
+    basic_hash_map(std::initializer_list<value_type> list)
+    {
+        insert(list);
+    }
+
+    // data_size is in bytes. required_size(n) tells how many bytes are needed for n elements.
+    template<bool mapped = is_mapped_memory_v<Memory>, fc_require(mapped)>
+    basic_hash_map(void* data, size_t data_size)
+        : super(data, data_size)
+    {
+    }
+
+    bool operator==(const basic_hash_map& v) const
+    {
+        if (this->size() != v.size()) {
+            return false;
+        }
+        for (auto& kvp : *this) {
+            auto it = v.find(kvp.first);
+            if (it == v.end() || !(it->second == kvp.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const basic_hash_map& v) const { return !operator==(v); }
+
+    // insert & erase
+
+    std::pair<iterator, bool> insert(const value_type& v)
+    {
+        return this->_insert_unique(v);
+    }
+    std::pair<iterator, bool> insert(value_type&& v)
+    {
+        return this->_insert_unique(std::move(v));
+    }
+    template<class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    void insert(Iter first, Iter last)
+    {
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>) {
+            this->reserve(this->size() + std::distance(first, last));
+        }
+        for (auto i = first; i != last; ++i) {
+            insert(*i);
+        }
+    }
+    void insert(std::initializer_list<value_type> list)
+    {
+        insert(list.begin(), list.end());
+    }
+
+    template<class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        // key is needed before construction. construct a temporary and move it if the key is new.
+        std::pair<Key, Value> tmp(std::forward<Args>(args)...);
+        return this->_try_insert(tmp.first, [&](auto* dst) { _construct_at(dst, std::move(tmp)); });
+    }
+
+    template<class... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& k, Args&&... args)
+    {
+        return this->_try_insert(k, [&](auto* dst) {
+            _construct_at(dst, std::piecewise_construct, std::forward_as_tuple(k), std::forward_as_tuple(std::forward<Args>(args)...));
+            });
+    }
+    template<class... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& k, Args&&... args)
+    {
+        return this->_try_insert(k, [&](auto* dst) {
+            _construct_at(dst, std::piecewise_construct, std::forward_as_tuple(std::move(k)), std::forward_as_tuple(std::forward<Args>(args)...));
+            });
+    }
+
+    template<class V>
+    std::pair<iterator, bool> insert_or_assign(const key_type& k, V&& v)
+    {
+        auto r = try_emplace(k, std::forward<V>(v));
+        if (!r.second) {
+            r.first->second = std::forward<V>(v);
+        }
+        return r;
+    }
+
+    mapped_type& at(const key_type& v)
+    {
+        if (auto it = this->find(v); it != this->end()) {
+            return it->second;
+        }
+        else {
+            throw std::out_of_range("flat_hash_map::at()");
+        }
+    }
+    const mapped_type& at(const key_type& v) const
+    {
+        if (auto it = this->find(v); it != this->end()) {
+            return it->second;
+        }
+        else {
+            throw std::out_of_range("flat_hash_map::at()");
+        }
+    }
+
+    mapped_type& operator[](const key_type& v)
+    {
+        return try_emplace(v).first->second;
+    }
+    mapped_type& operator[](key_type&& v)
+    {
+        return try_emplace(std::move(v)).first->second;
+    }
+};
+
+
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using flat_hash_map = basic_hash_map<Key, Value, Hash, KeyEqual, dynamic_memory<hash_group<std::pair<Key, Value>>>>;
+
+// Capacity is the number of elements that can be held without exceeding max load factor.
+template <class Key, class Value, size_t Capacity, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using fixed_hash_map = basic_hash_map<Key, Value, Hash, KeyEqual, fixed_memory<hash_group<std::pair<Key, Value>>, _hash_group_count(Capacity)>>;
+
+template <class Key, class Value, size_t Capacity, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using sbo_hash_map = basic_hash_map<Key, Value, Hash, KeyEqual, sbo_memory<hash_group<std::pair<Key, Value>>, _hash_group_count(Capacity)>>;
+
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using mapped_hash_map = basic_hash_map<Key, Value, Hash, KeyEqual, mapped_memory<hash_group<std::pair<Key, Value>>>>;
+
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using arena_hash_map = basic_hash_map<Key, Value, Hash, KeyEqual, arena_memory<hash_group<std::pair<Key, Value>>>>;
+
+} // namespace ist
+
+
+namespace std {
+
+template<class K, class V, class H, class E, class M>
+inline void swap(ist::basic_hash_map<K, V, H, E, M>& l, ist::basic_hash_map<K, V, H, E, M>& r) noexcept
+{
+    l.swap(r);
+}
+
+} // namespace std
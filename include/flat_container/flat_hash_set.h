@@ -0,0 +1,133 @@
+#pragma once
+#include "hash_table.h"
+
+namespace ist {
+
+// open addressing hash set (swiss table style. see hash_table.h)
+// unlike std::unordered_set, insertion may move elements and invalidate iterators & references.
+template <
+    class Key,
+    class Hash,
+    class KeyEqual,
+    class Memory
+>
+class basic_hash_set : public basic_hash_table<Key, _hash_key_self, Hash, KeyEqual, Memory>
+{
+using super = basic_hash_table<Key, _hash_key_self, Hash, KeyEqual, Memory>;
+public:
+    using key_type               = Key;
+    using value_type             = Key;
+    using reference              = const value_type&;
+    using const_reference        = const value_type&;
+    using typename super::size_type;
+    using typename super::difference_type;
+    using typename super::hasher;
+    using typename super::key_equal;
+    using iterator               = typename super::const_iterator; // elements must not be modified
+    using const_iterator         = typename super::const_iterator;
+
+    basic_hash_set() {}
+    basic_hash_set(const basic_hash_set& v) = default;
+    basic_hash_set(basic_hash_set&& v) noexcept = default;
+    basic_hash_set& operator=(const basic_hash_set& v) = default;
+    basic_hash_set& operator=(basic_hash_set&& v) noexcept = default;
+
+    template <class Iter, bool mapped = is_mapped_memory_v<Memory>, fc_require(!mapped), fc_require(is_iterator_v<Iter, value_type>)>
+    basic_hash_set(Iter first, Iter last)
+    {
+        insert(first, last);
+    }
+    template <bool mapped = is_mapped_memory_v<Memory>, fc_require(!mapped)>
+    basic_hash_set(std::initializer_list<value_type> list)
+    {
+        insert(list);
+    }
+
+    // data_size is in bytes. required_size(n) tells how many bytes are needed for n elements.
+    template<bool mapped = is_mapped_memory_v<Memory>, fc_require(mapped)>
+    basic_hash_set(void* data, size_t data_size)
+        : super(data, data_size)
+    {
+    }
+
+    const_iterator begin() const noexcept { return super::begin(); }
+    const_iterator end() const noexcept { return super::end(); }
+    const_iterator find(const key_type& v) const { return super::find(v); }
+    template <class V, class H = Hash, class = typename H::is_transparent>
+    const_iterator find(const V& v) const { return super::template find<V, H>(v); }
+
+    bool operator==(const basic_hash_set& v) const
+    {
+        if (this->size() != v.size()) {
+            return false;
+        }
+        for (auto& k : *this) {
+            if (!v.contains(k)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const basic_hash_set& v) const { return !operator==(v); }
+
+    // insert & erase
+
+    std::pair<iterator, bool> insert(const value_type& v)
+    {
+        return this->_insert_unique(v);
+    }
+    std::pair<iterator, bool> insert(value_type&& v)
+    {
+        return this->_insert_unique(std::move(v));
+    }
+    template<class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    void insert(Iter first, Iter last)
+    {
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>) {
+            this->reserve(this->size() + std::distance(first, last));
+        }
+        for (auto i = first; i != last; ++i) {
+            insert(*i);
+        }
+    }
+    void insert(std::initializer_list<value_type> list)
+    {
+        insert(list.begin(), list.end());
+    }
+
+    template<class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+};
+
+
+template <class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using flat_hash_set = basic_hash_set<Key, Hash, KeyEqual, dynamic_memory<hash_group<Key>>>;
+
+// Capacity is the number of elements that can be held without exceeding max load factor.
+template <class Key, size_t Capacity, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using fixed_hash_set = basic_hash_set<Key, Hash, KeyEqual, fixed_memory<hash_group<Key>, _hash_group_count(Capacity)>>;
+
+template <class Key, size_t Capacity, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using sbo_hash_set = basic_hash_set<Key, Hash, KeyEqual, sbo_memory<hash_group<Key>, _hash_group_count(Capacity)>>;
+
+template <class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using mapped_hash_set = basic_hash_set<Key, Hash, KeyEqual, mapped_memory<hash_group<Key>>>;
+
+template <class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+using arena_hash_set = basic_hash_set<Key, Hash, KeyEqual, arena_memory<hash_group<Key>>>;
+
+} // namespace ist
+
+
+namespace std {
+
+template<class K, class H, class E, class M>
+inline void swap(ist::basic_hash_set<K, H, E, M>& l, ist::basic_hash_set<K, H, E, M>& r) noexcept
+{
+    l.swap(r);
+}
+
+} // namespace std
@@ -4,6 +4,9 @@
 #include <utility>
 #include <initializer_list>
 #include "vector.h"
+#include "simd.h"
+#include "parallel_sort.h"
+#include "batch_search.h"
 
 namespace ist {
 
@@ -48,12 +51,34 @@ public:
         insert(list);
     }
 
+    // construct from sorted & unique data without sorting.
+    basic_map(sorted_unique_t, const container_type& v) : data_(v) { sorted_check(); }
+    basic_map(sorted_unique_t, container_type&& v) : data_(std::move(v)) { sorted_check(); }
+    template <class Iter, bool mapped = is_mapped_memory_v<container_type>, fc_require(!mapped), fc_require(is_iterator_v<Iter, value_type>)>
+    basic_map(sorted_unique_t, Iter first, Iter last)
+    {
+        insert(sorted_unique, first, last);
+    }
+    template <bool mapped = is_mapped_memory_v<container_type>, fc_require(!mapped)>
+    basic_map(sorted_unique_t, std::initializer_list<value_type> list)
+    {
+        insert(sorted_unique, list);
+    }
+
     template<bool mapped = is_mapped_memory_v<container_type>, fc_require(mapped)>
     basic_map(void* data, size_t capacity, size_t size = 0)
         : data_(data, capacity, size)
     {
     }
 
+    // open file backed container. content in the file is assumed to be sorted & unique.
+    template<bool file = is_file_mapped_memory_v<container_type>, fc_require(file)>
+    explicit basic_map(const char* path, file_open_mode mode = file_open_mode::open_or_create)
+        : data_(path, mode)
+    {
+        sorted_check();
+    }
+
     basic_map& operator=(const basic_map& v)
     {
         data_ = v.data_;
@@ -66,7 +91,7 @@ public:
     }
     basic_map& operator=(const container_type& v)
     {
-        data_ = v.data_;
+        data_ = v;
         sort();
         return *this;
     }
@@ -86,7 +111,17 @@ public:
         sort();
     }
 
+    // take ownership of sorted & unique container without sorting.
+    void adopt(container_type&& v)
+    {
+        data_ = std::move(v);
+        sorted_check();
+    }
+
     const container_type& get() const { return data_; }
+    // flush file backed content to the storage (see file_mapped_memory)
+    template<bool file = is_file_mapped_memory_v<container_type>, fc_require(file)>
+    void sync() const { data_.sync(); }
     container_type&& extract() { return std::move(data_); }
 
     bool operator==(const basic_map& v) const noexcept { return data_ == v.data_; }
@@ -110,21 +145,31 @@ public:
     // search
     iterator lower_bound(const key_type& v)
     {
-        return std::lower_bound(begin(), end(), v, cmp_first<>());
+        return begin() + lower_index<key_type, key_compare>(v);
     }
     const_iterator lower_bound(const key_type& v) const
     {
-        return std::lower_bound(begin(), end(), v, cmp_first<>());
+        return begin() + lower_index<key_type, key_compare>(v);
     }
     template <class V, class C = Compare, class = typename C::is_transparent>
     iterator lower_bound(const V& v)
     {
-        return std::lower_bound(begin(), end(), v, cmp_first<C>());
+        if constexpr (has_to_key_v<C, V>) {
+            return lower_bound(C::to_key(v));
+        }
+        else {
+            return begin() + lower_index<V, C>(v);
+        }
     }
     template <class V, class C = Compare, class = typename C::is_transparent>
     const_iterator lower_bound(const V& v) const
     {
-        return std::lower_bound(begin(), end(), v, cmp_first<C>());
+        if constexpr (has_to_key_v<C, V>) {
+            return lower_bound(C::to_key(v));
+        }
+        else {
+            return begin() + lower_index<V, C>(v);
+        }
     }
 
     iterator upper_bound(const key_type& v)
@@ -178,14 +223,24 @@ public:
     template <class V, class C = Compare, class = typename C::is_transparent>
     iterator find(const V& v)
     {
-        auto it = lower_bound<V, C>(v);
-        return (it != end() && equal<key_type, V, C>(it->first, v)) ? it : end();
+        if constexpr (has_to_key_v<C, V>) {
+            return find(C::to_key(v));
+        }
+        else {
+            auto it = lower_bound<V, C>(v);
+            return (it != end() && equal<key_type, V, C>(it->first, v)) ? it : end();
+        }
     }
     template <class V, class C = Compare, class = typename C::is_transparent>
     const_iterator find(const V& v) const
     {
-        auto it = lower_bound<V, C>(v);
-        return (it != end() && equal<key_type, V, C>(it->first, v)) ? it : end();
+        if constexpr (has_to_key_v<C, V>) {
+            return find(C::to_key(v));
+        }
+        else {
+            auto it = lower_bound<V, C>(v);
+            return (it != end() && equal<key_type, V, C>(it->first, v)) ? it : end();
+        }
     }
 
     size_t count(const key_type& v) const
@@ -198,6 +253,40 @@ public:
         return find<V, C>(v) != end() ? 1 : 0;
     }
 
+    // batch search. lower_bound() / find() of each key in keys (random access range, e.g. std::vector or span)
+    // is written to out in the same order. much faster than searching one by one on large data. (see batch_search.h)
+    // if keys are sorted, they are searched by a forward sweep.
+    template <class Keys, class OutIter>
+    OutIter lower_bound_many(const Keys& keys, OutIter out)
+    {
+        lower_index_many(keys, [&](auto&, size_t i) { *out++ = begin() + i; });
+        return out;
+    }
+    template <class Keys, class OutIter>
+    OutIter lower_bound_many(const Keys& keys, OutIter out) const
+    {
+        lower_index_many(keys, [&](auto&, size_t i) { *out++ = begin() + i; });
+        return out;
+    }
+    template <class Keys, class OutIter>
+    OutIter find_many(const Keys& keys, OutIter out)
+    {
+        lower_index_many(keys, [&](auto& k, size_t i) {
+            auto it = begin() + i;
+            *out++ = (it != end() && equal_key(it->first, k)) ? it : end();
+        });
+        return out;
+    }
+    template <class Keys, class OutIter>
+    OutIter find_many(const Keys& keys, OutIter out) const
+    {
+        lower_index_many(keys, [&](auto& k, size_t i) {
+            auto it = begin() + i;
+            *out++ = (it != end() && equal_key(it->first, k)) ? it : end();
+        });
+        return out;
+    }
+
     // insert & erase
 
     std::pair<iterator, bool> insert(const value_type& v)
@@ -223,9 +312,17 @@ public:
     template<class Iter, fc_require(is_iterator_v<Iter, value_type>)>
     void insert(Iter first, Iter last)
     {
-        for (auto i = first; i != last; ++i) {
-            insert(*i);
-        }
+        insert_range(first, last, false);
+    }
+    // [first, last) must be sorted and unique. it can overlap existing elements.
+    template<class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    void insert(sorted_unique_t, Iter first, Iter last)
+    {
+        insert_range(first, last, true);
+    }
+    void insert(sorted_unique_t, std::initializer_list<value_type> list)
+    {
+        insert_range(list.begin(), list.end(), true);
     }
     void insert(std::initializer_list<value_type> list)
     {
@@ -290,19 +387,137 @@ public:
 
 
 private:
-    void sort()
+    // sort the whole content and remove duplicates. (keeps the first occurrence of each key)
+    void sort() { merge_tail(0, false); }
+
+    template<class Iter>
+    void insert_range(Iter first, Iter last, bool sorted)
+    {
+        // append all, then sort the appended part and merge it with existing elements.
+        // O((N+M) log N) instead of O(N*M) of inserting one by one.
+        if constexpr (!std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>) {
+            // single-pass input can't be measured in advance. insert one by one.
+            for (auto i = first; i != last; ++i) {
+                insert(*i);
+            }
+            return;
+        }
+        size_t pos = size();
+        size_t n = std::distance(first, last);
+        data_.reserve(pos + n);
+        if (data_.capacity() < pos + n) {
+            // fixed or mapped memory can't hold duplicates temporarily. fallback to one-by-one insertion.
+            for (auto i = first; i != last; ++i) {
+                insert(*i);
+            }
+            return;
+        }
+        for (auto i = first; i != last; ++i) {
+            data_.push_back(*i);
+        }
+        merge_tail(pos, sorted);
+    }
+
+    // sort [pos, end()) (if not sorted yet), merge it with [begin(), pos) and remove duplicates.
+    // stable sort & merge keep the first occurrence of each key, same as inserting one by one.
+    void merge_tail(size_t pos, bool sorted)
     {
-        std::sort(begin(), end(), [](auto& a, auto& b) { return key_compare()(a.first, b.first); });
+        auto cmp = [](auto& a, auto& b) { return key_compare()(a.first, b.first); };
+        auto mid = begin() + pos;
+        if (!sorted) {
+            _parallel_stable_sort(mid, end(), cmp);
+        }
+        else if (pos == 0) {
+            sorted_check();
+            return;
+        }
+        if (pos != 0 && mid != end() && cmp(*mid, *(mid - 1))) {
+            _parallel_inplace_merge(begin(), mid, end(), cmp);
+        }
+        data_.erase(std::unique(begin(), end(), [](auto& a, auto& b) { return equal(a.first, b.first); }), end());
+    }
+
+    void sorted_check() const
+    {
+#ifdef FC_ENABLE_SORTED_CHECK
+        auto it = std::adjacent_find(data_.begin(), data_.end(), [](auto& a, auto& b) { return !key_compare()(a.first, b.first); });
+        if (it != data_.end()) {
+            throw std::invalid_argument("not sorted or not unique");
+        }
+#endif
+    }
+
+    template <class V, class C>
+    size_t lower_index(const V& v) const
+    {
+        if constexpr (std::is_same_v<V, key_type> && is_linear_searchable_v<key_type, C>) {
+            // keys are interleaved with values so SIMD doesn't fit, but a branchless scan still beats binary search.
+            // it touches values too, so the crossover is about half of the SIMD version.
+            if (data_.size() <= linear_search_threshold / 2) {
+                size_t r = 0;
+                for (auto& kvp : data_) {
+                    r += kvp.first < v ? 1 : 0;
+                }
+                return r;
+            }
+        }
+        return std::distance(data_.begin(), std::lower_bound(data_.begin(), data_.end(), v, cmp_first<C>()));
+    }
+
+    // f(key, lower bound index) for each key. key is converted by Compare::to_key() if it has, same as find().
+    template <class Keys, class F>
+    void lower_index_many(const Keys& keys, F&& f) const
+    {
+        using C = Compare;
+        using V = std::decay_t<decltype(*std::begin(keys))>;
+        if constexpr (!std::is_same_v<V, key_type> && has_to_key_v<C, V>) {
+            std::vector<key_type> converted;
+            converted.reserve(std::size(keys));
+            for (auto& k : keys) {
+                converted.push_back(C::to_key(k));
+            }
+            lower_index_many(converted, f);
+        }
+        else {
+            auto first = std::begin(keys);
+            size_t n = std::size(keys);
+            if (data_.size() <= linear_search_threshold) {
+                for (size_t i = 0; i < n; ++i) {
+                    f(first[i], lower_index<V, C>(first[i]));
+                }
+                return;
+            }
+            auto less = cmp_first<C>();
+            bool sorted = false;
+            if constexpr (std::is_invocable_r_v<bool, C, const V&, const V&>) {
+                sorted = std::is_sorted(first, first + n, C());
+            }
+            if (sorted) {
+                _lower_bound_many_sorted(data_.data(), data_.size(), first, n, less, f);
+            }
+            else {
+                _lower_bound_many(data_.data(), data_.size(), first, n, less, f);
+            }
+        }
     }
 
     template<class C = Compare>
     struct cmp_first
     {
+        // take container's element type to avoid conversion to value_type (= copy)
+        using element_type = typename container_type::value_type;
+
         template<class T>
-        bool operator()(const value_type& a, const T& b) const
+        bool operator()(const element_type& a, const T& b) const
         {
             return C()(a.first, b);
         }
+        // for upper_bound()
+        template<class T>
+        bool operator()(const T& a, const element_type& b) const
+        {
+            return C()(a, b.first);
+        }
     };
 
     static bool equal(const key_type& a, const key_type& b)
@@ -314,6 +529,16 @@ private:
     {
         return !C()(a, b) && !C()(b, a);
     }
+    template <class V>
+    static bool equal_key(const key_type& a, const V& b)
+    {
+        if constexpr (std::is_same_v<V, key_type>) {
+            return equal(a, b);
+        }
+        else {
+            return equal<key_type, V, Compare>(a, b);
+        }
+    }
 
 private:
     container_type data_;
@@ -363,6 +588,9 @@ using sbo_map = basic_map<Key, Value, Compare, sbo_vector<std::pair<Key, Value>,
 template <class Key, class Value, class Compare = std::less<>>
 using mapped_map = basic_map<Key, Value, Compare, mapped_vector<std::pair<Key, Value>>>;
 
+template <class Key, class Value, class Compare = std::less<>>
+using arena_map = basic_map<Key, Value, Compare, arena_vector<std::pair<Key, Value>>>;
+
 } // namespace ist
 
 
@@ -3,6 +3,9 @@
 #include <algorithm>
 #include <initializer_list>
 #include "vector.h"
+#include "simd.h"
+#include "parallel_sort.h"
+#include "batch_search.h"
 
 namespace ist {
 
@@ -47,12 +50,34 @@ public:
         insert(list);
     }
 
+    // construct from sorted & unique data without sorting.
+    basic_set(sorted_unique_t, const container_type& v) : data_(v) { sorted_check(); }
+    basic_set(sorted_unique_t, container_type&& v) : data_(std::move(v)) { sorted_check(); }
+    template <class Iter, bool mapped = is_mapped_memory_v<container_type>, fc_require(!mapped), fc_require(is_iterator_v<Iter, value_type>)>
+    basic_set(sorted_unique_t, Iter first, Iter last)
+    {
+        insert(sorted_unique, first, last);
+    }
+    template <bool mapped = is_mapped_memory_v<container_type>, fc_require(!mapped)>
+    basic_set(sorted_unique_t, std::initializer_list<value_type> list)
+    {
+        insert(sorted_unique, list);
+    }
+
     template<bool mapped = is_mapped_memory_v<container_type>, fc_require(mapped)>
     basic_set(void* data, size_t capacity, size_t size = 0)
         : data_(data, capacity, size)
     {
     }
 
+    // open file backed container. content in the file is assumed to be sorted & unique.
+    template<bool file = is_file_mapped_memory_v<container_type>, fc_require(file)>
+    explicit basic_set(const char* path, file_open_mode mode = file_open_mode::open_or_create)
+        : data_(path, mode)
+    {
+        sorted_check();
+    }
+
     basic_set& operator=(const basic_set& v)
     {
         data_ = v.data_;
@@ -65,7 +90,7 @@ public:
     }
     basic_set& operator=(const container_type& v)
     {
-        data_ = v.data_;
+        data_ = v;
         sort();
         return *this;
     }
@@ -85,7 +110,17 @@ public:
         sort();
     }
 
+    // take ownership of sorted & unique container without sorting.
+    void adopt(container_type&& v)
+    {
+        data_ = std::move(v);
+        sorted_check();
+    }
+
     const container_type& get() const { return data_; }
+    // flush file backed content to the storage (see file_mapped_memory)
+    template<bool file = is_file_mapped_memory_v<container_type>, fc_require(file)>
+    void sync() const { data_.sync(); }
     container_type&& extract() { return std::move(data_); }
 
     bool operator==(const basic_set& v) const { return data_ == v.data_; }
@@ -109,21 +144,31 @@ public:
 
     iterator lower_bound(const value_type& v)
     {
-        return std::lower_bound(begin(), end(), v, key_compare());
+        return begin() + lower_index<value_type, key_compare>(v);
     }
     const_iterator lower_bound(const value_type& v) const
     {
-        return std::lower_bound(begin(), end(), v, key_compare());
+        return begin() + lower_index<value_type, key_compare>(v);
     }
     template <class V, class C = Compare, class = typename C::is_transparent>
     iterator lower_bound(const V& v)
     {
-        return std::lower_bound(begin(), end(), v, C());
+        if constexpr (has_to_key_v<C, V>) {
+            return lower_bound(C::to_key(v));
+        }
+        else {
+            return begin() + lower_index<V, C>(v);
+        }
     }
     template <class V, class C = Compare, class = typename C::is_transparent>
     const_iterator lower_bound(const V& v) const
     {
-        return std::lower_bound(begin(), end(), v, C());
+        if constexpr (has_to_key_v<C, V>) {
+            return lower_bound(C::to_key(v));
+        }
+        else {
+            return begin() + lower_index<V, C>(v);
+        }
     }
 
     iterator upper_bound(const value_type& v)
@@ -177,14 +222,24 @@ public:
     template <class V, class C = Compare, class = typename C::is_transparent>
     iterator find(const V& v)
     {
-        auto it = lower_bound<V, C>(v);
-        return (it != end() && equal<value_type, V, C>(*it, v)) ? it : end();
+        if constexpr (has_to_key_v<C, V>) {
+            return find(C::to_key(v));
+        }
+        else {
+            auto it = lower_bound<V, C>(v);
+            return (it != end() && equal<value_type, V, C>(*it, v)) ? it : end();
+        }
     }
     template <class V, class C = Compare, class = typename C::is_transparent>
     const_iterator find(const V& v) const
     {
-        auto it = lower_bound<V, C>(v);
-        return (it != end() && equal<value_type, V, C>(*it, v)) ? it : end();
+        if constexpr (has_to_key_v<C, V>) {
+            return find(C::to_key(v));
+        }
+        else {
+            auto it = lower_bound<V, C>(v);
+            return (it != end() && equal<value_type, V, C>(*it, v)) ? it : end();
+        }
     }
 
     size_t count(const value_type& v) const
@@ -197,6 +252,40 @@ public:
         return find<V, C>(v) != end() ? 1 : 0;
     }
 
+    // batch search. lower_bound() / find() of each key in keys (random access range, e.g. std::vector or span)
+    // is written to out in the same order. much faster than searching one by one on large data. (see batch_search.h)
+    // if keys are sorted, they are searched by a forward sweep.
+    template <class Keys, class OutIter>
+    OutIter lower_bound_many(const Keys& keys, OutIter out)
+    {
+        lower_index_many(keys, [&](auto&, size_t i) { *out++ = begin() + i; });
+        return out;
+    }
+    template <class Keys, class OutIter>
+    OutIter lower_bound_many(const Keys& keys, OutIter out) const
+    {
+        lower_index_many(keys, [&](auto&, size_t i) { *out++ = begin() + i; });
+        return out;
+    }
+    template <class Keys, class OutIter>
+    OutIter find_many(const Keys& keys, OutIter out)
+    {
+        lower_index_many(keys, [&](auto& k, size_t i) {
+            auto it = begin() + i;
+            *out++ = (it != end() && equal_key(*it, k)) ? it : end();
+        });
+        return out;
+    }
+    template <class Keys, class OutIter>
+    OutIter find_many(const Keys& keys, OutIter out) const
+    {
+        lower_index_many(keys, [&](auto& k, size_t i) {
+            auto it = begin() + i;
+            *out++ = (it != end() && equal_key(*it, k)) ? it : end();
+        });
+        return out;
+    }
+
     // insert & erase
 
     std::pair<iterator, bool> insert(const value_type& v)
@@ -222,9 +311,17 @@ public:
     template<class Iter, fc_require(is_iterator_v<Iter, value_type>)>
     void insert(Iter first, Iter last)
     {
-        for (auto i = first; i != last; ++i) {
-            insert(*i);
-        }
+        insert_range(first, last, false);
+    }
+    // [first, last) must be sorted and unique. it can overlap existing elements.
+    template<class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    void insert(sorted_unique_t, Iter first, Iter last)
+    {
+        insert_range(first, last, true);
+    }
+    void insert(sorted_unique_t, std::initializer_list<value_type> list)
+    {
+        insert_range(list.begin(), list.end(), true);
     }
     void insert(std::initializer_list<value_type> list)
     {
@@ -250,7 +347,113 @@ public:
     }
 
 private:
-    void sort() { std::sort(begin(), end(), key_compare()); }
+    // sort the whole content and remove duplicates. (keeps the first occurrence of each key)
+    void sort() { merge_tail(0, false); }
+
+    template<class Iter>
+    void insert_range(Iter first, Iter last, bool sorted)
+    {
+        // append all, then sort the appended part and merge it with existing elements.
+        // O((N+M) log N) instead of O(N*M) of inserting one by one.
+        if constexpr (!std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>) {
+            // single-pass input can't be measured in advance. insert one by one.
+            for (auto i = first; i != last; ++i) {
+                insert(*i);
+            }
+            return;
+        }
+        size_t pos = size();
+        size_t n = std::distance(first, last);
+        data_.reserve(pos + n);
+        if (data_.capacity() < pos + n) {
+            // fixed or mapped memory can't hold duplicates temporarily. fallback to one-by-one insertion.
+            for (auto i = first; i != last; ++i) {
+                insert(*i);
+            }
+            return;
+        }
+        for (auto i = first; i != last; ++i) {
+            data_.push_back(*i);
+        }
+        merge_tail(pos, sorted);
+    }
+
+    template <class V, class C>
+    size_t lower_index(const V& v) const
+    {
+        if constexpr (std::is_same_v<V, key_type> && is_linear_searchable_v<key_type, C>) {
+            // small arithmetic keys: SIMD linear scan beats binary search
+            if (data_.size() <= linear_search_threshold) {
+                return _linear_lower_bound(data_.data(), data_.size(), v);
+            }
+        }
+        return std::distance(data_.begin(), std::lower_bound(data_.begin(), data_.end(), v, C()));
+    }
+
+    // f(key, lower bound index) for each key. key is converted by Compare::to_key() if it has, same as find().
+    template <class Keys, class F>
+    void lower_index_many(const Keys& keys, F&& f) const
+    {
+        using C = Compare;
+        using V = std::decay_t<decltype(*std::begin(keys))>;
+        if constexpr (!std::is_same_v<V, key_type> && has_to_key_v<C, V>) {
+            std::vector<key_type> converted;
+            converted.reserve(std::size(keys));
+            for (auto& k : keys) {
+                converted.push_back(C::to_key(k));
+            }
+            lower_index_many(converted, f);
+        }
+        else {
+            auto first = std::begin(keys);
+            size_t n = std::size(keys);
+            if (data_.size() <= linear_search_threshold) {
+                for (size_t i = 0; i < n; ++i) {
+                    f(first[i], lower_index<V, C>(first[i]));
+                }
+                return;
+            }
+            auto less = C();
+            bool sorted = false;
+            if constexpr (std::is_invocable_r_v<bool, C, const V&, const V&>) {
+                sorted = std::is_sorted(first, first + n, C());
+            }
+            if (sorted) {
+                _lower_bound_many_sorted(data_.data(), data_.size(), first, n, less, f);
+            }
+            else {
+                _lower_bound_many(data_.data(), data_.size(), first, n, less, f);
+            }
+        }
+    }
+
+    // sort [pos, end()) (if not sorted yet), merge it with [begin(), pos) and remove duplicates.
+    // stable sort & merge keep the first occurrence of each key, same as inserting one by one.
+    void merge_tail(size_t pos, bool sorted)
+    {
+        auto mid = begin() + pos;
+        if (!sorted) {
+            _parallel_stable_sort(mid, end(), key_compare());
+        }
+        else if (pos == 0) {
+            sorted_check();
+            return;
+        }
+        if (pos != 0 && mid != end() && key_compare()(*mid, *(mid - 1))) {
+            _parallel_inplace_merge(begin(), mid, end(), key_compare());
+        }
+        data_.erase(std::unique(begin(), end(), [](auto& a, auto& b) { return equal(a, b); }), end());
+    }
+
+    void sorted_check() const
+    {
+#ifdef FC_ENABLE_SORTED_CHECK
+        auto it = std::adjacent_find(data_.begin(), data_.end(), [](auto& a, auto& b) { return !key_compare()(a, b); });
+        if (it != data_.end()) {
+            throw std::invalid_argument("not sorted or not unique");
+        }
+#endif
+    }
 
     static bool equal(const value_type& a, const value_type& b)
     {
@@ -261,6 +464,16 @@ private:
     {
         return !C()(a, b) && !C()(b, a);
     }
+    template <class V>
+    static bool equal_key(const key_type& a, const V& b)
+    {
+        if constexpr (std::is_same_v<V, key_type>) {
+            return equal(a, b);
+        }
+        else {
+            return equal<key_type, V, Compare>(a, b);
+        }
+    }
 
 private:
     container_type data_;
@@ -310,6 +523,9 @@ using sbo_set = basic_set<Key, Compare, sbo_vector<Key, Capacity>>;
 template <class Key, class Compare = std::less<>>
 using mapped_set = basic_set<Key, Compare, mapped_vector<Key>>;
 
+template <class Key, class Compare = std::less<>>
+using arena_set = basic_set<Key, Compare, arena_vector<Key>>;
+
 } // namespace ist
 
 
@@ -0,0 +1,297 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <initializer_list>
+#include "flat_map.h"
+#include "frozen_set.h"
+
+namespace ist {
+
+// read-optimized flat map.
+// pairs are stored in sorted order for iteration, and a copy of keys is stored in eytzinger layout for search.
+// search touches only the dense key array until the element is found, so values don't pollute cache.
+// values can be modified, but keys can't. use assign() to rebuild.
+template <
+    class Key,
+    class Value,
+    class Compare = std::less<>,
+    class Container = std::vector<std::pair<Key, Value>, std::allocator<std::pair<Key, Value>>>
+>
+class basic_frozen_map
+{
+public:
+    using key_type               = Key;
+    using mapped_type            = Value;
+    using value_type             = std::pair<const key_type, mapped_type>;
+    using size_type              = std::size_t;
+    using difference_type        = std::ptrdiff_t;
+    using key_compare            = Compare;
+    using reference              = value_type&;
+    using const_reference        = const value_type&;
+    using pointer                = value_type*;
+    using const_pointer          = const value_type*;
+    using container_type         = Container;
+    using iterator               = typename container_type::iterator;
+    using const_iterator         = typename container_type::const_iterator;
+
+    basic_frozen_map() {}
+    basic_frozen_map(const basic_frozen_map& v) { operator=(v); }
+    basic_frozen_map(basic_frozen_map&& v) noexcept { operator=(std::move(v)); }
+    basic_frozen_map(sorted_unique_t, const container_type& v) { assign(sorted_unique, container_type(v)); }
+    basic_frozen_map(sorted_unique_t, container_type&& v) { assign(sorted_unique, std::move(v)); }
+
+    template <class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    basic_frozen_map(Iter first, Iter last)
+    {
+        assign(first, last);
+    }
+    basic_frozen_map(std::initializer_list<value_type> list)
+    {
+        assign(list.begin(), list.end());
+    }
+
+    basic_frozen_map& operator=(const basic_frozen_map& v)
+    {
+        data_ = v.data_;
+        keys_ = v.keys_;
+        return *this;
+    }
+    basic_frozen_map& operator=(basic_frozen_map&& v) noexcept
+    {
+        swap(v);
+        return *this;
+    }
+
+    void swap(basic_frozen_map& v) noexcept
+    {
+        data_.swap(v.data_);
+        keys_.swap(v.keys_);
+    }
+
+    // rebuild
+    template <class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    void assign(Iter first, Iter last)
+    {
+        basic_map<Key, Value, Compare, Container> tmp(first, last);
+        assign(sorted_unique, tmp.extract());
+    }
+    void assign(sorted_unique_t, container_type&& v)
+    {
+        basic_map<Key, Value, Compare, Container> tmp(sorted_unique, std::move(v)); // verify if enabled
+        data_ = tmp.extract();
+        build();
+    }
+
+    const container_type& get() const { return data_; }
+    container_type&& extract()
+    {
+        keys_.clear();
+        return std::move(data_);
+    }
+
+    bool operator==(const basic_frozen_map& v) const noexcept { return data_ == v.data_; }
+    bool operator!=(const basic_frozen_map& v) const noexcept { return data_ != v.data_; }
+
+    void clear()
+    {
+        data_.clear();
+        keys_.clear();
+    }
+    void shrink_to_fit()
+    {
+        data_.shrink_to_fit();
+        keys_.shrink_to_fit();
+    }
+
+    size_type empty() const noexcept { return data_.empty(); }
+    size_type size() const noexcept { return data_.size(); }
+    pointer data() noexcept { return data_.data(); }
+    const_pointer data() const noexcept { return data_.data(); }
+    iterator begin() noexcept { return data_.begin(); }
+    const_iterator begin() const noexcept { return data_.begin(); }
+    constexpr const_iterator cbegin() const noexcept { return data_.cbegin(); }
+    iterator end() noexcept { return data_.end(); }
+    const_iterator end() const noexcept { return data_.end(); }
+    constexpr const_iterator cend() const noexcept { return data_.cend(); }
+
+    // search
+
+    iterator lower_bound(const key_type& v)
+    {
+        return to_iterator(search_lower<key_type, key_compare>(v));
+    }
+    const_iterator lower_bound(const key_type& v) const
+    {
+        return to_iterator(search_lower<key_type, key_compare>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    iterator lower_bound(const V& v)
+    {
+        return to_iterator(search_lower<V, C>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator lower_bound(const V& v) const
+    {
+        return to_iterator(search_lower<V, C>(v));
+    }
+
+    iterator upper_bound(const key_type& v)
+    {
+        return to_iterator(search_upper<key_type, key_compare>(v));
+    }
+    const_iterator upper_bound(const key_type& v) const
+    {
+        return to_iterator(search_upper<key_type, key_compare>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    iterator upper_bound(const V& v)
+    {
+        return to_iterator(search_upper<V, C>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator upper_bound(const V& v) const
+    {
+        return to_iterator(search_upper<V, C>(v));
+    }
+
+    std::pair<iterator, iterator> equal_range(const key_type& v)
+    {
+        auto it = find(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& v) const
+    {
+        auto it = find(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    std::pair<iterator, iterator> equal_range(const V& v)
+    {
+        auto it = find<V, C>(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const V& v) const
+    {
+        auto it = find<V, C>(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+
+    iterator find(const key_type& v)
+    {
+        return to_iterator(search_equal<key_type, key_compare>(v));
+    }
+    const_iterator find(const key_type& v) const
+    {
+        return to_iterator(search_equal<key_type, key_compare>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    iterator find(const V& v)
+    {
+        return to_iterator(search_equal<V, C>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator find(const V& v) const
+    {
+        return to_iterator(search_equal<V, C>(v));
+    }
+
+    size_t count(const key_type& v) const
+    {
+        return find(v) != end() ? 1 : 0;
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    size_t count(const V& v) const
+    {
+        return find<V, C>(v) != end() ? 1 : 0;
+    }
+
+    mapped_type& at(const key_type& v)
+    {
+        if (auto it = find(v); it != end()) {
+            return it->second;
+        }
+        else {
+            throw std::out_of_range("frozen_map::at()");
+        }
+    }
+    const mapped_type& at(const key_type& v) const
+    {
+        if (auto it = find(v); it != end()) {
+            return it->second;
+        }
+        else {
+            throw std::out_of_range("frozen_map::at()");
+        }
+    }
+
+private:
+    void build()
+    {
+        keys_.clear();
+        if (!data_.empty()) {
+            keys_.resize(data_.size() + 1); // [0] is unused
+            _eytzinger_build(keys_, data_, [](const auto& v) -> const key_type& { return v.first; });
+        }
+    }
+
+    // these return index in keys_. 0 means not found.
+    template <class V, class C>
+    size_t search_lower(const V& v) const
+    {
+        return _eytzinger_search(keys_.data(), size(), [&v](const key_type& k) { return C()(k, v); });
+    }
+    template <class V, class C>
+    size_t search_upper(const V& v) const
+    {
+        return _eytzinger_search(keys_.data(), size(), [&v](const key_type& k) { return !C()(v, k); });
+    }
+    template <class V, class C>
+    size_t search_equal(const V& v) const
+    {
+        size_t k = search_lower<V, C>(v);
+        return (k != 0 && !C()(v, keys_[k])) ? k : 0;
+    }
+
+    iterator to_iterator(size_t k)
+    {
+        return k == 0 ? end() : begin() + _eytzinger_rank(k, size());
+    }
+    const_iterator to_iterator(size_t k) const
+    {
+        return k == 0 ? end() : begin() + _eytzinger_rank(k, size());
+    }
+
+private:
+    container_type data_;
+    vector<key_type> keys_; // eytzinger layout
+};
+
+template<class K, class V, class Comp, class Cont1, class Cont2>
+bool operator==(const basic_frozen_map<K, V, Comp, Cont1>& l, const basic_frozen_map<K, V, Comp, Cont2>& r)
+{
+    return l.size() == r.size() && std::equal(l.begin(), l.end(), r.begin());
+}
+template<class K, class V, class Comp, class Cont1, class Cont2>
+bool operator!=(const basic_frozen_map<K, V, Comp, Cont1>& l, const basic_frozen_map<K, V, Comp, Cont2>& r)
+{
+    return l.size() != r.size() || !std::equal(l.begin(), l.end(), r.begin());
+}
+
+
+template <class Key, class Value, class Compare = std::less<>>
+using frozen_map = basic_frozen_map<Key, Value, Compare, std::vector<std::pair<Key, Value>, std::allocator<std::pair<Key, Value>>>>;
+
+} // namespace ist
+
+
+namespace std {
+
+template<class K, class V, class Comp, class Cont>
+inline void swap(ist::basic_frozen_map<K, V, Comp, Cont>& l, ist::basic_frozen_map<K, V, Comp, Cont>& r) noexcept
+{
+    l.swap(r);
+}
+
+} // namespace std
@@ -0,0 +1,301 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include "flat_set.h"
+
+namespace ist {
+
+// eytzinger (BFS order) layout helpers.
+// node k has children at 2k and 2k+1 (1-based). top levels of the tree share few cache lines,
+// and the descendants of the next few levels are contiguous, so they can be prefetched.
+
+inline int _floor_log2(size_t v)
+{
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll((unsigned long long)v);
+#else
+    int r = 0;
+    while (v >>= 1) {
+        ++r;
+    }
+    return r;
+#endif
+}
+
+// fill keys in in-order traversal order. keys[0] is unused.
+template<class Key, class Source, class GetKey>
+inline size_t _eytzinger_build(vector<Key>& keys, const Source& src, GetKey&& get_key, size_t i = 0, size_t k = 1)
+{
+    if (k < keys.size()) {
+        i = _eytzinger_build(keys, src, get_key, i, k * 2);
+        keys[k] = get_key(src[i++]);
+        i = _eytzinger_build(keys, src, get_key, i, k * 2 + 1);
+    }
+    return i;
+}
+
+// node index -> index in the sorted array, without a lookup table.
+// compute the rank as if the tree is perfect, then subtract missing leaves at the last level that precede it.
+inline size_t _eytzinger_rank(size_t k, size_t n)
+{
+    int height = _floor_log2(n);
+    int depth = _floor_log2(k);
+    size_t leaves = n - ((size_t(1) << height) - 1);
+    size_t r = ((2 * (k - (size_t(1) << depth)) + 1) << (height - depth)) - 1;
+    size_t leaves_before = (r + 1) / 2;
+    return r - (leaves_before > leaves ? leaves_before - leaves : 0);
+}
+
+// search descends to a leaf. the answer is the node where we went left last time.
+// = strip trailing 1 bits (right turns) and one more bit (the left turn).
+inline size_t _eytzinger_resolve(size_t k)
+{
+#if defined(__GNUC__)
+    return k >> (__builtin_ctzll(~(unsigned long long)k) + 1);
+#else
+    while (k & 1) {
+        k >>= 1;
+    }
+    return k >> 1;
+#endif
+}
+
+template<class Key, class Less>
+inline size_t _eytzinger_search(const Key* keys, size_t n, Less&& go_right)
+{
+    // descendants of k at a few levels below are contiguous. prefetch the ones that fit in a cache line.
+    // (prefetching out of range address is harmless)
+    constexpr size_t prefetch_distance = std::max<size_t>(64 / sizeof(Key), 1);
+    size_t k = 1;
+    while (k <= n) {
+        fc_prefetch(keys + k * prefetch_distance);
+        k = k * 2 + size_t(go_right(keys[k])); // branchless
+    }
+    return _eytzinger_resolve(k);
+}
+
+
+// read-optimized flat set.
+// elements are stored in sorted order for iteration, and a copy of keys is stored in eytzinger layout for search.
+// search is much more cache friendly than binary search on sorted array with large data.
+// content can't be modified partially; use assign() to rebuild.
+template <
+    class Key,
+    class Compare = std::less<>,
+    class Container = std::vector<Key, std::allocator<Key>>
+>
+class basic_frozen_set
+{
+public:
+    using key_type               = Key;
+    using value_type             = Key;
+    using size_type              = std::size_t;
+    using difference_type        = std::ptrdiff_t;
+    using key_compare            = Compare;
+    using value_compare          = Compare;
+    using reference              = Key&;
+    using const_reference        = const Key&;
+    using pointer                = Key*;
+    using const_pointer          = const Key*;
+    using container_type         = Container;
+    using iterator               = typename container_type::const_iterator;
+    using const_iterator         = typename container_type::const_iterator;
+
+    basic_frozen_set() {}
+    basic_frozen_set(const basic_frozen_set& v) { operator=(v); }
+    basic_frozen_set(basic_frozen_set&& v) noexcept { operator=(std::move(v)); }
+    basic_frozen_set(const container_type& v) { assign(v.begin(), v.end()); }
+    basic_frozen_set(sorted_unique_t, const container_type& v) { assign(sorted_unique, container_type(v)); }
+    basic_frozen_set(sorted_unique_t, container_type&& v) { assign(sorted_unique, std::move(v)); }
+
+    template <class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    basic_frozen_set(Iter first, Iter last)
+    {
+        assign(first, last);
+    }
+    basic_frozen_set(std::initializer_list<value_type> list)
+    {
+        assign(list.begin(), list.end());
+    }
+
+    basic_frozen_set& operator=(const basic_frozen_set& v)
+    {
+        data_ = v.data_;
+        keys_ = v.keys_;
+        return *this;
+    }
+    basic_frozen_set& operator=(basic_frozen_set&& v) noexcept
+    {
+        swap(v);
+        return *this;
+    }
+
+    void swap(basic_frozen_set& v) noexcept
+    {
+        data_.swap(v.data_);
+        keys_.swap(v.keys_);
+    }
+
+    // rebuild
+    template <class Iter, fc_require(is_iterator_v<Iter, value_type>)>
+    void assign(Iter first, Iter last)
+    {
+        basic_set<Key, Compare, Container> tmp(first, last);
+        assign(sorted_unique, tmp.extract());
+    }
+    void assign(sorted_unique_t, container_type&& v)
+    {
+        basic_set<Key, Compare, Container> tmp(sorted_unique, std::move(v)); // verify if enabled
+        data_ = tmp.extract();
+        build();
+    }
+
+    const container_type& get() const { return data_; }
+    container_type&& extract()
+    {
+        keys_.clear();
+        return std::move(data_);
+    }
+
+    bool operator==(const basic_frozen_set& v) const { return data_ == v.data_; }
+    bool operator!=(const basic_frozen_set& v) const { return data_ != v.data_; }
+
+    void clear()
+    {
+        data_.clear();
+        keys_.clear();
+    }
+    void shrink_to_fit()
+    {
+        data_.shrink_to_fit();
+        keys_.shrink_to_fit();
+    }
+
+    size_type empty() const noexcept { return data_.empty(); }
+    size_type size() const noexcept { return data_.size(); }
+    const_pointer data() const noexcept { return data_.data(); }
+    const_iterator begin() const noexcept { return data_.begin(); }
+    constexpr const_iterator cbegin() const noexcept { return data_.cbegin(); }
+    const_iterator end() const noexcept { return data_.end(); }
+    constexpr const_iterator cend() const noexcept { return data_.cend(); }
+
+    // search
+
+    const_iterator lower_bound(const value_type& v) const
+    {
+        return to_iterator(search_lower<value_type, key_compare>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator lower_bound(const V& v) const
+    {
+        return to_iterator(search_lower<V, C>(v));
+    }
+
+    const_iterator upper_bound(const value_type& v) const
+    {
+        return to_iterator(search_upper<value_type, key_compare>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator upper_bound(const V& v) const
+    {
+        return to_iterator(search_upper<V, C>(v));
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const value_type& v) const
+    {
+        auto it = find(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const V& v) const
+    {
+        auto it = find<V, C>(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+
+    const_iterator find(const value_type& v) const
+    {
+        return to_iterator(search_equal<value_type, key_compare>(v));
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator find(const V& v) const
+    {
+        return to_iterator(search_equal<V, C>(v));
+    }
+
+    size_t count(const value_type& v) const
+    {
+        return find(v) != end() ? 1 : 0;
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    size_t count(const V& v) const
+    {
+        return find<V, C>(v) != end() ? 1 : 0;
+    }
+
+private:
+    void build()
+    {
+        keys_.clear();
+        if (!data_.empty()) {
+            keys_.resize(data_.size() + 1); // [0] is unused
+            _eytzinger_build(keys_, data_, [](const key_type& v) -> const key_type& { return v; });
+        }
+    }
+
+    // these return index in keys_. 0 means not found.
+    template <class V, class C>
+    size_t search_lower(const V& v) const
+    {
+        return _eytzinger_search(keys_.data(), size(), [&v](const key_type& k) { return C()(k, v); });
+    }
+    template <class V, class C>
+    size_t search_upper(const V& v) const
+    {
+        return _eytzinger_search(keys_.data(), size(), [&v](const key_type& k) { return !C()(v, k); });
+    }
+    template <class V, class C>
+    size_t search_equal(const V& v) const
+    {
+        size_t k = search_lower<V, C>(v);
+        return (k != 0 && !C()(v, keys_[k])) ? k : 0;
+    }
+
+    const_iterator to_iterator(size_t k) const
+    {
+        return k == 0 ? end() : begin() + _eytzinger_rank(k, size());
+    }
+
+private:
+    container_type data_;
+    vector<key_type> keys_; // eytzinger layout
+};
+
+template<class K, class Comp, class Cont1, class Cont2>
+bool operator==(const basic_frozen_set<K, Comp, Cont1>& l, const basic_frozen_set<K, Comp, Cont2>& r)
+{
+    return l.size() == r.size() && std::equal(l.begin(), l.end(), r.begin());
+}
+template<class K, class Comp, class Cont1, class Cont2>
+bool operator!=(const basic_frozen_set<K, Comp, Cont1>& l, const basic_frozen_set<K, Comp, Cont2>& r)
+{
+    return l.size() != r.size() || !std::equal(l.begin(), l.end(), r.begin());
+}
+
+
+template <class Key, class Compare = std::less<>>
+using frozen_set = basic_frozen_set<Key, Compare, std::vector<Key, std::allocator<Key>>>;
+
+} // namespace ist
+
+
+namespace std {
+
+template<class K, class Comp, class Cont>
+inline void swap(ist::basic_frozen_set<K, Comp, Cont>& l, ist::basic_frozen_set<K, Comp, Cont>& r) noexcept
+{
+    l.swap(r);
+}
+
+} // namespace std
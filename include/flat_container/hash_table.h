@@ -0,0 +1,674 @@
+#pragma once
+#include <functional>
+#include <utility>
+#include <initializer_list>
+#include "vector_base.h"
+#include "simd.h"
+
+namespace ist {
+
+// swiss table style open addressing hash table.
+// slots are split into groups of 16. a group has 16 control bytes followed by 16 slots.
+// a control byte is empty, deleted (tombstone) or the lower 7 bits of the hash of the element in the slot (H2).
+// lookup compares all control bytes of a group at once with SIMD, and touches slots only on H2 match.
+// unlike abseil's, groups are aligned and probing moves group by group (triangular), so control bytes don't need to be cloned.
+// groups are allocated by the memory models in memory.h, so fixed_memory gives a hash table with no heap allocation.
+
+enum : int8_t
+{
+    _hash_ctrl_empty = -128, // 0b10000000
+    _hash_ctrl_deleted = -2, // 0b11111110
+    // full: 0b0xxxxxxx (H2)
+};
+
+template<class Slot>
+struct hash_group
+{
+    static constexpr size_t width = 16;
+
+    int8_t ctrl[width];
+    alignas(Slot) std::byte storage[sizeof(Slot) * width]; // uninitialized in intention
+
+    Slot* slots() noexcept { return (Slot*)storage; }
+    const Slot* slots() const noexcept { return (const Slot*)storage; }
+};
+
+// bit masks of control bytes that match conditions
+class _hash_ctrl_group
+{
+public:
+#if defined(fc_sse2)
+    explicit _hash_ctrl_group(const int8_t* ctrl) : ctrl_(_mm_loadu_si128((const __m128i*)ctrl)) {}
+
+    uint32_t match(int8_t h2) const { return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)); }
+    uint32_t match_empty() const { return match(_hash_ctrl_empty); }
+    // empty or deleted
+    uint32_t match_free() const { return (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl_)); }
+    uint32_t match_full() const { return ~(uint32_t)_mm_movemask_epi8(ctrl_) & 0xffff; }
+
+private:
+    __m128i ctrl_;
+#else
+    explicit _hash_ctrl_group(const int8_t* ctrl) : ctrl_(ctrl) {}
+
+    uint32_t match(int8_t h2) const { return match_if([h2](int8_t c) { return c == h2; }); }
+    uint32_t match_empty() const { return match(_hash_ctrl_empty); }
+    uint32_t match_free() const { return match_if([](int8_t c) { return c < -1; }); }
+    uint32_t match_full() const { return match_if([](int8_t c) { return c >= 0; }); }
+
+private:
+    template<class Cond>
+    uint32_t match_if(Cond&& cond) const
+    {
+        uint32_t r = 0;
+        for (int i = 0; i < 16; ++i) {
+            r |= uint32_t(cond(ctrl_[i])) << i;
+        }
+        return r;
+    }
+
+    const int8_t* ctrl_;
+#endif
+};
+
+// std::hash of integers is identity on some implementations. spread bits so that both H1 and H2 are usable.
+inline size_t _hash_mix(size_t h)
+{
+    uint64_t v = h;
+#if defined(__SIZEOF_INT128__)
+    __uint128_t m = (__uint128_t)v * 0x9e3779b97f4a7c15ull;
+    v = uint64_t(m) ^ uint64_t(m >> 64);
+#else
+    v = (v ^ (v >> 33)) * 0xff51afd7ed558ccdull;
+    v = (v ^ (v >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    v = v ^ (v >> 33);
+#endif
+    return size_t(v);
+}
+
+// number of groups to hold n elements without exceeding max load factor (7/8). always power of 2.
+inline constexpr size_t _hash_group_count(size_t n)
+{
+    size_t groups = (n + 13) / 14;
+    size_t r = 1;
+    while (r < groups) {
+        r *= 2;
+    }
+    return r;
+}
+
+struct _hash_key_self
+{
+    template<class T>
+    const T& operator()(const T& v) const noexcept { return v; }
+};
+struct _hash_key_first
+{
+    template<class T>
+    const auto& operator()(const T& v) const noexcept { return v.first; }
+};
+
+
+template<class Slot, class GetKey, class Hash, class KeyEqual, class Memory>
+class basic_hash_table;
+
+template<class Slot, bool Const>
+class hash_iterator
+{
+template<class, class, class, class, class> friend class basic_hash_table;
+template<class, bool> friend class hash_iterator;
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Slot;
+    using pointer = std::conditional_t<Const, const Slot*, Slot*>;
+    using reference = std::conditional_t<Const, const Slot&, Slot&>;
+    using group_type = std::conditional_t<Const, const hash_group<Slot>, hash_group<Slot>>;
+
+    hash_iterator() {}
+    hash_iterator(group_type* group, group_type* end, size_t index)
+        : group_(group), end_(end), index_(index)
+    {
+    }
+    template<bool C = Const, fc_require(C)>
+    hash_iterator(const hash_iterator<Slot, false>& v)
+        : group_(v.group_), end_(v.end_), index_(v.index_)
+    {
+    }
+
+    reference operator*() const { return group_->slots()[index_]; }
+    pointer operator->() const { return &group_->slots()[index_]; }
+    hash_iterator& operator++()
+    {
+        ++index_;
+        skip_free();
+        return *this;
+    }
+    hash_iterator operator++(int)
+    {
+        auto ret = *this;
+        ++*this;
+        return ret;
+    }
+    bool operator==(const hash_iterator& v) const { return group_ == v.group_ && index_ == v.index_; }
+    bool operator!=(const hash_iterator& v) const { return !(*this == v); }
+
+private:
+    void skip_free()
+    {
+        while (group_ != end_) {
+            if (uint32_t full = _hash_ctrl_group(group_->ctrl).match_full() >> index_) {
+                index_ += _ctz(full);
+                return;
+            }
+            ++group_;
+            index_ = 0;
+        }
+        index_ = 0;
+    }
+
+    group_type* group_ = nullptr;
+    group_type* end_ = nullptr;
+    size_t index_ = 0;
+};
+
+
+// Memory is a memory model of hash_group<Slot>. capacity_ in Memory is the number of groups.
+template<class Slot, class GetKey, class Hash, class KeyEqual, class Memory>
+class basic_hash_table : public Memory
+{
+using super = Memory;
+public:
+    using key_type        = std::remove_const_t<std::remove_reference_t<decltype(GetKey()(std::declval<Slot>()))>>;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = KeyEqual;
+    using group_type      = hash_group<Slot>;
+    using iterator        = hash_iterator<Slot, false>;
+    using const_iterator  = hash_iterator<Slot, true>;
+
+    static constexpr size_t group_width = group_type::width;
+
+    basic_hash_table()
+    {
+        if constexpr (is_fixed_memory_v<super> || is_sbo_memory_v<super>) {
+            _init_ctrl(_groups(), this->capacity_);
+        }
+    }
+    basic_hash_table(const basic_hash_table& r) : basic_hash_table() { operator=(r); }
+    basic_hash_table(basic_hash_table&& r) noexcept : basic_hash_table() { operator=(std::move(r)); }
+
+    // data_size is in bytes. (use required_size() to know how many bytes are needed)
+    // existing content of the memory is ignored.
+    template<bool mapped = is_mapped_memory_v<super>, fc_require(mapped)>
+    basic_hash_table(void* data, size_t data_size)
+        : super(data, _floor_pow2(data_size / sizeof(group_type)), 0)
+    {
+        _init_ctrl(_groups(), this->capacity_);
+    }
+
+    ~basic_hash_table()
+    {
+        clear();
+        _release();
+    }
+
+    basic_hash_table& operator=(const basic_hash_table& r)
+    {
+        if (this != &r) {
+            clear();
+            reserve(r.size());
+            for (auto& v : r) {
+                _insert_unique(v);
+            }
+        }
+        return *this;
+    }
+    basic_hash_table& operator=(basic_hash_table&& r) noexcept
+    {
+        if constexpr (is_dynamic_memory_v<super> || is_mapped_memory_v<super> || is_arena_memory_v<super>) {
+            swap(r);
+        }
+        else if constexpr (is_sbo_memory_v<super>) {
+            if (r._on_heap()) {
+                clear();
+                _release();
+                this->capacity_ = r.capacity_;
+                this->size_ = r.size_;
+                this->data_ = r.data_;
+                deleted_ = r.deleted_;
+                r._reset_buffer();
+            }
+            else {
+                _move_content(r);
+            }
+        }
+        else {
+            _move_content(r);
+        }
+        return *this;
+    }
+
+    void swap(basic_hash_table& r)
+    {
+        if constexpr (is_arena_memory_v<super>) {
+            // the groups belong to the arena. it goes with the arena pointer.
+            this->_swap(r);
+            std::swap(deleted_, r.deleted_);
+        }
+        else if constexpr (is_dynamic_memory_v<super> || is_mapped_memory_v<super>) {
+            std::swap(this->capacity_, r.capacity_);
+            std::swap(this->size_, r.size_);
+            std::swap(this->data_, r.data_);
+            std::swap(deleted_, r.deleted_);
+        }
+        else {
+            basic_hash_table tmp(std::move(r));
+            r = std::move(*this);
+            *this = std::move(tmp);
+        }
+    }
+
+    // number of elements that can be held. (fixed and mapped tables can be filled up to 100%)
+    constexpr size_t capacity() const noexcept
+    {
+        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super>) {
+            return _max_load();
+        }
+        else {
+            return this->capacity_ * group_width;
+        }
+    }
+    constexpr size_t size() const noexcept { return this->size_; }
+    constexpr bool empty() const noexcept { return this->size_ == 0; }
+    float load_factor() const noexcept { return this->capacity_ == 0 ? 0.0f : float(this->size_) / float(this->capacity_ * group_width); }
+
+    // bytes of memory to hold n elements with mapped memory model
+    static constexpr size_t required_size(size_t n) { return sizeof(group_type) * _hash_group_count(n); }
+
+    iterator begin() noexcept { return _make_iterator(0, 0, true); }
+    const_iterator begin() const noexcept { return _make_iterator(0, 0, true); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return _make_iterator(this->capacity_, 0); }
+    const_iterator end() const noexcept { return _make_iterator(this->capacity_, 0); }
+    const_iterator cend() const noexcept { return end(); }
+
+    void clear()
+    {
+        if (this->size_ == 0 && deleted_ == 0) {
+            return;
+        }
+        _for_each_full([](Slot* s) { _destroy_at(s); });
+        _init_ctrl(_groups(), this->capacity_);
+        this->size_ = 0;
+        deleted_ = 0;
+    }
+
+    void reserve(size_t n)
+    {
+        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super>) {
+            if (n > _max_load()) {
+                _rehash(_hash_group_count(n));
+            }
+        }
+    }
+
+    // search
+
+    iterator find(const key_type& v) { return _find(v); }
+    const_iterator find(const key_type& v) const { return _find(v); }
+    template <class V, class H = Hash, class = typename H::is_transparent>
+    iterator find(const V& v) { return _find(v); }
+    template <class V, class H = Hash, class = typename H::is_transparent>
+    const_iterator find(const V& v) const { return _find(v); }
+
+    size_t count(const key_type& v) const { return find(v) != end() ? 1 : 0; }
+    template <class V, class H = Hash, class = typename H::is_transparent>
+    size_t count(const V& v) const { return find<V, H>(v) != end() ? 1 : 0; }
+
+    bool contains(const key_type& v) const { return find(v) != end(); }
+    template <class V, class H = Hash, class = typename H::is_transparent>
+    bool contains(const V& v) const { return find<V, H>(v) != end(); }
+
+    // erase. elements are never moved by erase, so other iterators remain valid.
+
+    iterator erase(const_iterator pos)
+    {
+        size_t gi = pos.group_ - _groups();
+        size_t si = pos.index_;
+        _erase_at(gi, si);
+        return _make_iterator(gi, si + 1, true);
+    }
+    iterator erase(iterator pos)
+    {
+        return erase(const_iterator(pos));
+    }
+    iterator erase(const key_type& v)
+    {
+        if (auto it = find(v); it != end()) {
+            return erase(it);
+        }
+        else {
+            return end();
+        }
+    }
+
+protected:
+    group_type* _groups() noexcept { return (group_type*)this->data_; }
+    const group_type* _groups() const noexcept { return (const group_type*)this->data_; }
+
+    static size_t _floor_pow2(size_t n)
+    {
+        size_t r = 1;
+        while (r * 2 <= n) {
+            r *= 2;
+        }
+        return n == 0 ? 0 : r;
+    }
+    static void _init_ctrl(group_type* groups, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            std::memset(groups[i].ctrl, (uint8_t)_hash_ctrl_empty, group_width);
+        }
+    }
+    constexpr size_t _max_load() const noexcept { return this->capacity_ * (group_width - group_width / 8); }
+
+    template<class V>
+    static size_t _hash(const V& v) { return _hash_mix(Hash()(v)); }
+    static int8_t _h2(size_t h) { return int8_t(h & 0x7f); }
+    static size_t _h1(size_t h) { return h >> 7; }
+
+    iterator _make_iterator(size_t gi, size_t si, bool skip = false)
+    {
+        iterator r(_groups() + gi, _groups() + this->capacity_, si);
+        if (skip) {
+            r.skip_free();
+        }
+        return r;
+    }
+    const_iterator _make_iterator(size_t gi, size_t si, bool skip = false) const
+    {
+        const_iterator r(_groups() + gi, _groups() + this->capacity_, si);
+        if (skip) {
+            r.skip_free();
+        }
+        return r;
+    }
+
+    template<class Body>
+    void _for_each_full(Body&& body)
+    {
+        if (this->size_ == 0) {
+            return;
+        }
+        group_type* groups = _groups();
+        for (size_t gi = 0; gi < this->capacity_; ++gi) {
+            for (uint32_t m = _hash_ctrl_group(groups[gi].ctrl).match_full(); m; m &= m - 1) {
+                body(&groups[gi].slots()[_ctz(m)]);
+            }
+        }
+    }
+
+    // probe groups in triangular sequence. with power of 2 group count it visits all groups.
+    template<class Body>
+    bool _probe(size_t h, Body&& body) const
+    {
+        size_t mask = this->capacity_ - 1;
+        size_t gi = _h1(h) & mask;
+        for (size_t i = 0; i < this->capacity_; ) {
+            if (body(gi)) {
+                return true;
+            }
+            ++i;
+            gi = (gi + i) & mask;
+        }
+        return false;
+    }
+
+    // returns (group index, slot index). group index is capacity_ if not found.
+    template<class V>
+    std::pair<size_t, size_t> _find_index(const V& v, size_t h) const
+    {
+        std::pair<size_t, size_t> r{ this->capacity_, 0 };
+        int8_t h2 = _h2(h);
+        auto groups = _groups();
+        _probe(h, [&](size_t gi) {
+            auto& g = groups[gi];
+            _hash_ctrl_group ctrl(g.ctrl);
+            for (uint32_t m = ctrl.match(h2); m; m &= m - 1) {
+                size_t si = _ctz(m);
+                if (KeyEqual()(GetKey()(g.slots()[si]), v)) {
+                    r = { gi, si };
+                    return true;
+                }
+            }
+            return ctrl.match_empty() != 0; // stop at a group that has never been full
+            });
+        return r;
+    }
+    template<class V>
+    iterator _find(const V& v)
+    {
+        auto [gi, si] = _find_index(v, _hash(v));
+        return _make_iterator(gi, si);
+    }
+    template<class V>
+    const_iterator _find(const V& v) const
+    {
+        auto [gi, si] = _find_index(v, _hash(v));
+        return _make_iterator(gi, si);
+    }
+
+    // first empty or deleted slot in the probe sequence
+    std::pair<size_t, size_t> _find_free(size_t h) const
+    {
+        std::pair<size_t, size_t> r;
+        auto groups = _groups();
+        bool found = _probe(h, [&](size_t gi) {
+            if (uint32_t m = _hash_ctrl_group(groups[gi].ctrl).match_free()) {
+                r = { gi, (size_t)_ctz(m) };
+                return true;
+            }
+            return false;
+            });
+        if (!found) {
+            throw std::out_of_range("out of capacity");
+        }
+        return r;
+    }
+
+    // insert if the key doesn't exist. construct(Slot*) constructs the element.
+    template<class V, class Construct>
+    std::pair<iterator, bool> _try_insert(const V& key, Construct&& construct)
+    {
+        size_t h = _hash(key);
+        if (this->capacity_ != 0) {
+            auto [gi, si] = _find_index(key, h);
+            if (gi != this->capacity_) {
+                return { _make_iterator(gi, si), false };
+            }
+        }
+        if (this->size_ + deleted_ >= _max_load()) {
+            _make_room();
+        }
+        auto [gi, si] = _find_free(h);
+        auto& g = _groups()[gi];
+        construct(&g.slots()[si]);
+        if (g.ctrl[si] == _hash_ctrl_deleted) {
+            --deleted_;
+        }
+        g.ctrl[si] = _h2(h);
+        ++this->size_;
+        return { _make_iterator(gi, si), true };
+    }
+    template<class V>
+    std::pair<iterator, bool> _insert_unique(V&& v)
+    {
+        return _try_insert(GetKey()(v), [&](Slot* dst) { _construct_at(dst, std::forward<V>(v)); });
+    }
+
+    void _erase_at(size_t gi, size_t si)
+    {
+        auto& g = _groups()[gi];
+        _destroy_at(&g.slots()[si]);
+        --this->size_;
+        // a group that has an empty slot has never been full, so no probe sequence passes through it. (no tombstone needed)
+        if (_hash_ctrl_group(g.ctrl).match_empty()) {
+            g.ctrl[si] = _hash_ctrl_empty;
+        }
+        else {
+            g.ctrl[si] = _hash_ctrl_deleted;
+            ++deleted_;
+        }
+    }
+
+    void _make_room()
+    {
+        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super>) {
+            // if tombstones take much room, rehashing in place is enough
+            if (deleted_ != 0 && this->size_ * 2 < _max_load()) {
+                _drop_deleted();
+            }
+            else {
+                _rehash(std::max<size_t>(this->capacity_ * 2, 1));
+            }
+        }
+        else {
+            // can't grow. fill the table up to 100%. (_find_free() throws if it is full)
+            if (deleted_ != 0) {
+                _drop_deleted();
+            }
+        }
+    }
+
+    void _rehash(size_t new_capacity)
+    {
+        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super>) {
+            group_type* old_groups = _groups();
+            size_t old_capacity = this->capacity_;
+
+            group_type* new_groups = this->_allocate(new_capacity);
+            _init_ctrl(new_groups, new_capacity);
+            this->data_ = new_groups;
+            this->capacity_ = new_capacity;
+            deleted_ = 0;
+
+            for (size_t gi = 0; gi < old_capacity; ++gi) {
+                auto& g = old_groups[gi];
+                for (uint32_t m = _hash_ctrl_group(g.ctrl).match_full(); m; m &= m - 1) {
+                    Slot* src = &g.slots()[_ctz(m)];
+                    size_t h = _hash(GetKey()(*src));
+                    auto [ngi, nsi] = _find_free(h);
+                    auto& ng = new_groups[ngi];
+                    _construct_at(&ng.slots()[nsi], std::move(*src));
+                    ng.ctrl[nsi] = _h2(h);
+                    _destroy_at(src);
+                }
+            }
+            fc_memory_stats(super, _copy(this->size_, sizeof(Slot) * this->size_));
+            this->_deallocate(old_groups);
+        }
+    }
+
+    // remove tombstones without allocation.
+    // mark all elements as deleted (= not placed yet), then move them to the first free slot of their probe sequence.
+    void _drop_deleted()
+    {
+        group_type* groups = _groups();
+        for (size_t gi = 0; gi < this->capacity_; ++gi) {
+            for (auto& c : groups[gi].ctrl) {
+                c = c >= 0 ? _hash_ctrl_deleted : _hash_ctrl_empty;
+            }
+        }
+
+        alignas(Slot) std::byte tmp_storage[sizeof(Slot)];
+        Slot* tmp = (Slot*)tmp_storage;
+        for (size_t gi = 0; gi < this->capacity_; ++gi) {
+            auto& g = groups[gi];
+            for (size_t si = 0; si < group_width; ++si) {
+                while (g.ctrl[si] == _hash_ctrl_deleted) {
+                    Slot* src = &g.slots()[si];
+                    size_t h = _hash(GetKey()(*src));
+                    auto [dgi, dsi] = _find_free(h);
+                    if (dgi == gi) {
+                        // already in the right group
+                        g.ctrl[si] = _h2(h);
+                        break;
+                    }
+                    auto& dg = groups[dgi];
+                    Slot* dst = &dg.slots()[dsi];
+                    if (dg.ctrl[dsi] == _hash_ctrl_empty) {
+                        _construct_at(dst, std::move(*src));
+                        _destroy_at(src);
+                        dg.ctrl[dsi] = _h2(h);
+                        g.ctrl[si] = _hash_ctrl_empty;
+                    }
+                    else {
+                        // dst holds an element not placed yet. swap and continue with it.
+                        _construct_at(tmp, std::move(*dst));
+                        _destroy_at(dst);
+                        _construct_at(dst, std::move(*src));
+                        _destroy_at(src);
+                        _construct_at(src, std::move(*tmp));
+                        _destroy_at(tmp);
+                        dg.ctrl[dsi] = _h2(h);
+                    }
+                }
+            }
+        }
+        deleted_ = 0;
+    }
+
+    // move elements one by one. for fixed memory and sbo memory in the internal buffer.
+    void _move_content(basic_hash_table& r)
+    {
+        if (this == &r) {
+            return;
+        }
+        clear();
+        reserve(r.size());
+        r._for_each_full([&](Slot* s) { _insert_unique(std::move(*s)); });
+        r.clear();
+    }
+
+    bool _on_heap() const
+    {
+        if constexpr (is_sbo_memory_v<super>) {
+            return (const void*)this->data_ != (const void*)this->buffer_;
+        }
+        else {
+            return is_dynamic_memory_v<super>;
+        }
+    }
+    void _reset_buffer()
+    {
+        if constexpr (is_sbo_memory_v<super>) {
+            this->capacity_ = super::fixed_capacity;
+            this->size_ = 0;
+            this->data_ = (group_type*)this->buffer_;
+            deleted_ = 0;
+            _init_ctrl(_groups(), this->capacity_);
+        }
+    }
+    // elements must be destroyed beforehand
+    void _release()
+    {
+        if constexpr (is_dynamic_memory_v<super>) {
+            this->_deallocate(this->data_);
+            this->capacity_ = 0;
+            this->data_ = nullptr;
+            deleted_ = 0;
+        }
+        else if constexpr (is_sbo_memory_v<super>) {
+            if (_on_heap()) {
+                this->_deallocate(this->data_);
+                _reset_buffer();
+            }
+        }
+    }
+
+    size_t deleted_ = 0; // number of tombstones
+};
+
+} // namespace ist
@@ -0,0 +1,227 @@
+#pragma once
+#include "memory.h"
+
+#if defined(_WIN32)
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+namespace ist {
+
+// thin wrapper of memory mapped file. maps the whole of the file.
+// used by file_mapped_memory (mmap_memory.h) and memory_view_streambuf (memory_view_stream.h).
+// functions return false on failure instead of throwing.
+class mapped_file
+{
+public:
+    mapped_file() {}
+    ~mapped_file() { close(); }
+    // movable but non-copyable
+    mapped_file(mapped_file&& v) noexcept { swap(v); }
+    mapped_file& operator=(mapped_file&& v) noexcept { swap(v); return *this; }
+    mapped_file(const mapped_file& v) = delete;
+    mapped_file& operator=(const mapped_file& v) = delete;
+
+    // read only mapping ignores mode other than file_open_mode::open.
+    bool open(const char* path, file_open_mode mode = file_open_mode::open, bool writable = false)
+    {
+        close();
+        writable_ = writable;
+#if defined(_WIN32)
+        DWORD access = writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+        DWORD disposition = !writable || mode == file_open_mode::open ? OPEN_EXISTING : mode == file_open_mode::create ? CREATE_ALWAYS : OPEN_ALWAYS;
+        file_ = ::CreateFileA(path, access, FILE_SHARE_READ, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            file_ = nullptr;
+            return false;
+        }
+        LARGE_INTEGER file_size{};
+        ::GetFileSizeEx(file_, &file_size);
+        size_t size = (size_t)file_size.QuadPart;
+#else
+        int flags = !writable ? O_RDONLY :
+            mode == file_open_mode::create ? (O_RDWR | O_CREAT | O_TRUNC) :
+            mode == file_open_mode::open ? O_RDWR : (O_RDWR | O_CREAT);
+        fd_ = ::open(path, flags, 0644);
+        if (fd_ < 0) {
+            return false;
+        }
+        struct stat st {};
+        ::fstat(fd_, &st);
+        size_t size = (size_t)st.st_size;
+#endif
+        if (!_map(size)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        _unmap();
+#if defined(_WIN32)
+        if (file_) {
+            ::CloseHandle(file_);
+            file_ = nullptr;
+        }
+#else
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+#endif
+    }
+
+    // extend or truncate the file and remap. the address may change.
+    bool resize(size_t size)
+    {
+        if (!is_open() || !writable_) {
+            return false;
+        }
+        if (size == size_) {
+            return true;
+        }
+#if defined(_WIN32)
+        _unmap();
+        LARGE_INTEGER pos;
+        pos.QuadPart = (LONGLONG)size;
+        if (!::SetFilePointerEx(file_, pos, nullptr, FILE_BEGIN) || !::SetEndOfFile(file_)) {
+            return false;
+        }
+        return _map(size);
+#else
+        if (::ftruncate(fd_, (off_t)size) != 0) {
+            return false;
+        }
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+        if (data_ && size) {
+            void* addr = ::mremap(data_, size_, size, MREMAP_MAYMOVE);
+            if (addr == MAP_FAILED) {
+                return false;
+            }
+            data_ = (std::byte*)addr;
+            size_ = size;
+            return true;
+        }
+#endif
+        _unmap();
+        return _map(size);
+#endif
+    }
+
+    // flush mapped pages to the storage
+    bool sync() const
+    {
+        if (!data_ || !writable_) {
+            return true;
+        }
+#if defined(_WIN32)
+        return ::FlushViewOfFile(data_, size_) && ::FlushFileBuffers(file_);
+#else
+        return ::msync(data_, size_, MS_SYNC) == 0;
+#endif
+    }
+
+    // hint for sequential access. pages are read ahead aggressively.
+    void advise_sequential() const
+    {
+#if !defined(_WIN32) && defined(MADV_SEQUENTIAL)
+        if (data_) {
+            ::madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+#endif
+    }
+
+    void swap(mapped_file& v) noexcept
+    {
+        std::swap(data_, v.data_);
+        std::swap(size_, v.size_);
+        std::swap(writable_, v.writable_);
+#if defined(_WIN32)
+        std::swap(file_, v.file_);
+        std::swap(mapping_, v.mapping_);
+#else
+        std::swap(fd_, v.fd_);
+#endif
+    }
+
+    bool is_open() const noexcept
+    {
+#if defined(_WIN32)
+        return file_ != nullptr;
+#else
+        return fd_ >= 0;
+#endif
+    }
+    bool writable() const noexcept { return writable_; }
+    std::byte* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    // empty file can't be mapped. data_ is null in that case.
+    bool _map(size_t size)
+    {
+        size_ = size;
+        if (size == 0) {
+            return true;
+        }
+#if defined(_WIN32)
+        mapping_ = ::CreateFileMappingA(file_, nullptr, writable_ ? PAGE_READWRITE : PAGE_READONLY, DWORD((uint64_t)size >> 32), DWORD(size), nullptr);
+        void* addr = mapping_ ? ::MapViewOfFile(mapping_, writable_ ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size) : nullptr;
+        if (!addr) {
+            size_ = 0;
+            return false;
+        }
+#else
+        void* addr = ::mmap(nullptr, size, writable_ ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd_, 0);
+        if (addr == MAP_FAILED) {
+            size_ = 0;
+            return false;
+        }
+#endif
+        data_ = (std::byte*)addr;
+        return true;
+    }
+
+    void _unmap()
+    {
+        if (data_) {
+#if defined(_WIN32)
+            ::UnmapViewOfFile(data_);
+#else
+            ::munmap(data_, size_);
+#endif
+            data_ = nullptr;
+        }
+#if defined(_WIN32)
+        if (mapping_) {
+            ::CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+#endif
+        size_ = 0;
+    }
+
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+    bool writable_ = false;
+#if defined(_WIN32)
+    HANDLE file_ = nullptr;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace ist
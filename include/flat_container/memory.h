@@ -1,19 +1,46 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
 #include <initializer_list>
 #include <type_traits>
 #include <iterator>
 #include <type_traits>
 #include <memory>
+#include <utility>
+#include <new>
+#if defined(_MSC_VER)
+#   include <malloc.h>
+#elif defined(__APPLE__)
+#   include <malloc/malloc.h>
+#elif defined(__GLIBC__) || defined(__linux__)
+#   include <malloc.h>
+#elif defined(__FreeBSD__)
+#   include <malloc_np.h>
+#endif
+#include "memory_stats.h"
 
 #ifdef _DEBUG
 #   if !defined(FC_ENABLE_CAPACITY_CHECK)
 #       define FC_ENABLE_CAPACITY_CHECK
 #   endif
+#   if !defined(FC_ENABLE_SORTED_CHECK)
+#       define FC_ENABLE_SORTED_CHECK
+#   endif
 #endif
 
 #define fc_require(...) std::enable_if_t<__VA_ARGS__, bool> = true
 
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#   define fc_prefetch(addr) _mm_prefetch((const char*)(addr), _MM_HINT_T0)
+#else
+#   define fc_prefetch(addr) __builtin_prefetch(addr)
+#endif
+
 namespace ist {
 
 // type traits
@@ -21,6 +48,27 @@ namespace ist {
 template<typename T>
 constexpr bool is_pod_v = std::is_trivial_v<T>;
 
+// types that can be moved to another address by memcpy (= move + destroy can be replaced by memcpy).
+// dynamic_memory grows buffers of these types by realloc(), which may extend in place or remap pages without copy.
+// specialize this for user types that are trivially relocatable but not trivially copyable. e.g.:
+// template<> struct ist::is_trivially_relocatable<my_type> : std::true_type {};
+template<class T>
+struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+template<class T1, class T2>
+struct is_trivially_relocatable<std::pair<T1, T2>> : std::bool_constant<is_trivially_relocatable<T1>::value && is_trivially_relocatable<T2>::value> {};
+template<class T>
+constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+// types that can be stored as raw bytes in files & snapshots, and read back by another process.
+// relocatable is not enough: e.g. compact_string is relocatable but points to its heap buffer.
+// trivially copyable types except pointers are assumed to hold no pointers. specialize this for user types if needed.
+template<class T>
+struct is_pointer_free : std::bool_constant<std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && !std::is_member_pointer_v<T>> {};
+template<class T1, class T2>
+struct is_pointer_free<std::pair<T1, T2>> : std::bool_constant<is_pointer_free<T1>::value && is_pointer_free<T2>::value> {};
+template<class T>
+constexpr bool is_pointer_free_v = is_pointer_free<T>::value;
+
 template<class Iter, class T, class = void>
 constexpr bool is_iterator_v = false;
 template<class Iter, class T>
@@ -47,15 +95,161 @@ constexpr bool is_mapped_memory_v = false;
 template <class T>
 constexpr bool is_mapped_memory_v<T, std::enable_if_t<T::is_mapped_memory>> = true;
 
+template <class T, class = void>
+constexpr bool is_arena_memory_v = false;
+template <class T>
+constexpr bool is_arena_memory_v<T, std::enable_if_t<T::is_arena_memory>> = true;
+
+// file backed memory (see mmap_memory.h). is also dynamic memory.
+template <class T, class = void>
+constexpr bool is_file_mapped_memory_v = false;
+template <class T>
+constexpr bool is_file_mapped_memory_v<T, std::enable_if_t<T::is_file_mapped_memory>> = true;
+
+// memory models that pack data, size and capacity in their own layout (e.g. compact_string_memory).
+// containers access them by _get_data(), _get_size(), _put_size() and _get_capacity() instead of members.
+template <class T, class = void>
+constexpr bool is_packed_memory_v = false;
+template <class T>
+constexpr bool is_packed_memory_v<T, std::enable_if_t<T::is_packed_memory>> = true;
+
+enum class file_open_mode
+{
+    open_or_create,
+    create,         // truncate if exists
+    open,           // fail if not exists
+};
+
+
+// growth policies
+// next_capacity() returns the new capacity when a container needs to grow to hold `required` elements.
+// growable memory models (dynamic, sbo, arena) take one as a template parameter, so it is selectable per container type.
+// e.g. basic_vector<T, dynamic_memory<T, growth_1_5x>>
+
+struct growth_policy_base
+{
+    // if true, capacity is extended to the actual size of the allocated block. (see growth_usable_size)
+    static constexpr bool use_usable_size = false;
+};
+
+// default
+struct growth_2x : growth_policy_base
+{
+    static constexpr size_t next_capacity(size_t capacity, size_t required, size_t /*elem_size*/)
+    {
+        return std::max(required, capacity * 2);
+    }
+};
+
+// less memory overhead, more reallocation
+struct growth_1_5x : growth_policy_base
+{
+    static constexpr size_t next_capacity(size_t capacity, size_t required, size_t /*elem_size*/)
+    {
+        return std::max(required, capacity + capacity / 2);
+    }
+};
+
+// grows by Increment elements. overhead is bounded, but growth is O(n^2) in total.
+template<size_t Increment>
+struct growth_fixed : growth_policy_base
+{
+    static_assert(Increment > 0);
+    static constexpr size_t next_capacity(size_t capacity, size_t required, size_t /*elem_size*/)
+    {
+        return std::max(required, capacity + Increment);
+    }
+};
+
+// rounds up the size of the buffer to multiple of PageSize. for large buffers.
+template<class Base = growth_2x, size_t PageSize = 4096>
+struct growth_page_round : growth_policy_base
+{
+    static constexpr size_t next_capacity(size_t capacity, size_t required, size_t elem_size)
+    {
+        size_t bytes = Base::next_capacity(capacity, required, elem_size) * elem_size;
+        bytes = (bytes + (PageSize - 1)) / PageSize * PageSize;
+        return bytes / elem_size;
+    }
+};
+
+// extends capacity to the size class of the allocator. (malloc_usable_size() or equivalent)
+// malloc rounds up the size anyway, so the extra capacity is free.
+template<class Base = growth_2x>
+struct growth_usable_size : growth_policy_base
+{
+    static constexpr bool use_usable_size = true;
+    static constexpr size_t next_capacity(size_t capacity, size_t required, size_t elem_size)
+    {
+        return Base::next_capacity(capacity, required, elem_size);
+    }
+};
+
+// actual size of the block allocated by malloc(). 0 if unknown.
+inline size_t _malloc_usable_size(void* addr)
+{
+    if (!addr) {
+        return 0;
+    }
+#if defined(_MSC_VER)
+    return _msize(addr);
+#elif defined(__APPLE__)
+    return malloc_size(addr);
+#elif defined(__GLIBC__) || defined(__linux__) || defined(__FreeBSD__)
+    return malloc_usable_size(addr);
+#else
+    return 0;
+#endif
+}
+
+// malloc family for memory models. Memory is the memory model type that counts the statistics. (see memory_stats.h)
+template<class Memory>
+inline void* _mem_malloc(size_t bytes)
+{
+    void* r = std::malloc(bytes);
+#ifdef FC_ENABLE_MEMORY_STATS
+    if (r) {
+        fc_memory_stats(Memory, _allocate(bytes, _malloc_usable_size(r)));
+    }
+#endif
+    return r;
+}
+
+template<class Memory>
+inline void* _mem_realloc(void* addr, size_t bytes)
+{
+#ifdef FC_ENABLE_MEMORY_STATS
+    if (!addr) {
+        return _mem_malloc<Memory>(bytes);
+    }
+    size_t old_block = _malloc_usable_size(addr);
+    void* r = std::realloc(addr, bytes);
+    if (r) {
+        fc_memory_stats(Memory, _reallocate(bytes, old_block, _malloc_usable_size(r), r != addr));
+    }
+    return r;
+#else
+    return std::realloc(addr, bytes);
+#endif
+}
+
+template<class Memory>
+inline void _mem_free(void* addr)
+{
+    fc_memory_stats(Memory, _deallocate(addr, _malloc_usable_size(addr)));
+    std::free(addr);
+}
+
 
 // memory models
 
 // typical dynamic memory model
-template<class T>
+template<class T, class Growth = growth_2x>
 class dynamic_memory
 {
 public:
     using value_type = T;
+    using growth_policy = Growth;
     static constexpr bool is_dynamic_memory = true;
 
 protected:
@@ -64,12 +258,12 @@ protected:
         if (size == 0) {
             return nullptr;
         }
-        return (T*)std::malloc(sizeof(T) * size);
+        return (T*)_mem_malloc<dynamic_memory>(sizeof(T) * size);
     }
 
     void _deallocate(void *addr)
     {
-        std::free(addr);
+        _mem_free<dynamic_memory>(addr);
     }
 
     template<class Move>
@@ -78,12 +272,40 @@ protected:
         if (capacity_ == new_capaity) {
             return;
         }
-        T* new_data = _allocate(new_capaity);
-        move(new_data);
+        if constexpr (is_trivially_relocatable_v<T>) {
+            // elements are relocated by realloc(). move is not needed.
+            if (new_capaity == 0) {
+                _deallocate(data_);
+                data_ = nullptr;
+            }
+            else {
+                T* new_data = (T*)_mem_realloc<dynamic_memory>((void*)data_, sizeof(T) * new_capaity);
+                if (!new_data) {
+                    throw std::bad_alloc();
+                }
+                data_ = new_data;
+            }
+            capacity_ = _usable_capacity(data_, new_capaity);
+        }
+        else {
+            T* new_data = _allocate(new_capaity);
+            move(new_data);
 
-        _deallocate(data_);
-        data_ = new_data;
-        capacity_ = new_capaity;
+            _deallocate(data_);
+            data_ = new_data;
+            capacity_ = _usable_capacity(data_, new_capaity);
+        }
+    }
+
+    size_t _usable_capacity(T* data, size_t capacity)
+    {
+        // only when growing. otherwise shrink_to_fit() would never settle.
+        if constexpr (Growth::use_usable_size) {
+            if (capacity > capacity_) {
+                return std::max(capacity, _malloc_usable_size(data) / sizeof(T));
+            }
+        }
+        return capacity;
     }
 
     size_t capacity_ = 0;
@@ -116,11 +338,12 @@ protected:
 // if required size is smaller than internal buffer, internal buffer is used. otherwise, it allocates dynamic memory.
 // so, it behaves like hybrid of dynamic_memory and fixed_memory.
 // (many of std::string implementations use this strategy)
-template<class T, size_t Capacity>
+template<class T, size_t Capacity, class Growth = growth_2x>
 class sbo_memory
 {
 public:
     using value_type = T;
+    using growth_policy = Growth;
     static constexpr bool is_sbo_memory = true;
     static constexpr size_t fixed_capacity = Capacity;
 
@@ -133,14 +356,17 @@ protected:
             return (T*)buffer_;
         }
         else {
-            return (T*)std::malloc(sizeof(T) * size);
+            if (data_ == (T*)buffer_) {
+                fc_memory_stats(sbo_memory, _spill());
+            }
+            return (T*)_mem_malloc<sbo_memory>(sizeof(T) * size);
         }
     }
 
     void _deallocate(void* addr)
     {
         if (addr != buffer_) {
-            std::free(addr);
+            _mem_free<sbo_memory>(addr);
         }
     }
 
@@ -150,6 +376,18 @@ protected:
         if (capacity_ == new_capaity) {
             return;
         }
+        if constexpr (is_trivially_relocatable_v<T>) {
+            if (data_ != (T*)buffer_ && new_capaity > fixed_capacity) {
+                // heap to heap
+                T* new_data = (T*)_mem_realloc<sbo_memory>((void*)data_, sizeof(T) * new_capaity);
+                if (!new_data) {
+                    throw std::bad_alloc();
+                }
+                data_ = new_data;
+                capacity_ = _usable_capacity(data_, new_capaity);
+                return;
+            }
+        }
         T* new_data = _allocate(new_capaity);
         if (new_data == data_) {
             return;
@@ -158,7 +396,17 @@ protected:
 
         _deallocate(data_);
         data_ = new_data;
-        capacity_ = new_capaity;
+        capacity_ = _usable_capacity(data_, new_capaity);
+    }
+
+    size_t _usable_capacity(T* data, size_t capacity)
+    {
+        if constexpr (Growth::use_usable_size) {
+            if (capacity > capacity_ && data != (T*)buffer_) {
+                return std::max(capacity, _malloc_usable_size(data) / sizeof(T));
+            }
+        }
+        return capacity;
     }
 
     size_t capacity_ = fixed_capacity;
@@ -167,6 +415,339 @@ protected:
     std::byte buffer_[sizeof(T) * fixed_capacity]; // uninitialized in intention
 };
 
+// string memory whose inline buffer overlaps the heap pointer, size and capacity. (like libc++'s std::string)
+// the last byte tells the mode: inline size (< 0x80), or heap (0x80 bit is set. it is the top byte of the capacity field).
+// sizeof is Size. up to Size - 2 chars are stored inline. (the last byte is the mode, and one more is for the null terminator)
+// e.g. compact_string<24> holds 22 chars inline in 24 bytes, while sbo_string<22> takes 48 bytes.
+// unlike sbo_memory, nothing points into the object, so strings can be moved by memcpy.
+// for 1 byte char types. used by basic_string only.
+template<class T, size_t Size = 24, class Growth = growth_2x>
+class compact_string_memory
+{
+public:
+    using value_type = T;
+    using growth_policy = Growth;
+    static constexpr bool is_packed_memory = true;
+    static constexpr size_t inline_capacity = Size - 1;
+
+    static_assert(sizeof(T) == 1 && std::is_trivially_copyable_v<T>, "compact_string_memory is for 1 byte char types");
+    static_assert(Size % sizeof(size_t) == 0 && Size >= sizeof(T*) + sizeof(size_t) * 2 && Size <= 128);
+
+    compact_string_memory() noexcept {}
+    ~compact_string_memory()
+    {
+        if (_is_heap()) {
+            _mem_free<compact_string_memory>(heap_.data);
+        }
+    }
+
+protected:
+    static constexpr size_t num_words = Size / sizeof(size_t);
+    static constexpr uint8_t heap_flag = 0x80;
+
+    // capacity field is the last word. its last byte in memory is the mode byte.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    static constexpr size_t _encode_capacity(size_t v) noexcept { return (v << 8) | heap_flag; }
+    static constexpr size_t _decode_capacity(size_t v) noexcept { return v >> 8; }
+#else
+    static constexpr size_t _encode_capacity(size_t v) noexcept { return v | (size_t(heap_flag) << (sizeof(size_t) * 8 - 8)); }
+    static constexpr size_t _decode_capacity(size_t v) noexcept { return v & ~(size_t(0xff) << (sizeof(size_t) * 8 - 8)); }
+#endif
+
+    bool _is_heap() const noexcept { return (uint8_t)chars_[Size - 1] & heap_flag; }
+
+    T* _get_data() const noexcept { return _is_heap() ? heap_.data : (T*)chars_; }
+    size_t _get_size() const noexcept { return _is_heap() ? heap_.size : (uint8_t)chars_[Size - 1]; }
+    size_t _get_capacity() const noexcept { return _is_heap() ? _decode_capacity(words_[num_words - 1]) : inline_capacity; }
+    void _put_size(size_t n) noexcept
+    {
+        if (_is_heap()) {
+            heap_.size = n;
+        }
+        else {
+            chars_[Size - 1] = (T)n;
+        }
+    }
+
+    // elements are trivially copyable. move is not needed.
+    template<class Move>
+    void _reallocate(size_t new_capaity, Move&& /*move*/)
+    {
+        size_t size = _get_size(); // new_capaity is always >= size
+        if (new_capaity <= inline_capacity) {
+            if (_is_heap()) {
+                T* old = heap_.data;
+                std::memcpy(chars_, old, size + 1); // with the null terminator
+                _mem_free<compact_string_memory>(old);
+                fc_memory_stats(compact_string_memory, _copy(size, size));
+                chars_[Size - 1] = (T)size;
+            }
+            return;
+        }
+
+        if (_is_heap()) {
+            if (new_capaity == _get_capacity()) {
+                return;
+            }
+            T* new_data = (T*)_mem_realloc<compact_string_memory>(heap_.data, new_capaity);
+            if (!new_data) {
+                throw std::bad_alloc();
+            }
+            heap_.data = new_data;
+        }
+        else {
+            T* new_data = (T*)_mem_malloc<compact_string_memory>(new_capaity);
+            if (!new_data) {
+                throw std::bad_alloc();
+            }
+            std::memcpy(new_data, chars_, size + 1); // with the null terminator
+            fc_memory_stats(compact_string_memory, _spill());
+            fc_memory_stats(compact_string_memory, _copy(size, size));
+            heap_.data = new_data;
+            heap_.size = size;
+        }
+        if constexpr (Growth::use_usable_size) {
+            new_capaity = std::max(new_capaity, _malloc_usable_size(heap_.data));
+        }
+        words_[num_words - 1] = _encode_capacity(new_capaity);
+    }
+
+    void _swap(compact_string_memory& r) noexcept
+    {
+        std::swap(words_, r.words_);
+    }
+
+    struct heap_rep
+    {
+        T* data;
+        size_t size;
+    };
+    union {
+        heap_rep heap_;
+        T chars_[Size];
+        size_t words_[num_words]{}; // all zero = empty inline string
+    };
+};
+
+// monotonic (bump pointer) allocator.
+// deallocation does nothing except for the last allocation, and all memory is freed at once by reset() or destructor.
+// the last allocation can be resized in place, so a growing container that is the last user of the arena doesn't copy.
+// not thread safe. use one arena per thread or per request.
+class memory_arena
+{
+public:
+    static constexpr size_t default_block_size = 64 * 1024;
+
+    explicit memory_arena(size_t block_size = default_block_size) : block_size_(block_size) {}
+    // use buffer as the first block. it is not freed by the arena.
+    memory_arena(void* buffer, size_t size, size_t block_size = default_block_size)
+        : block_size_(block_size)
+    {
+        if (size > sizeof(block_header)) {
+            external_ = new (buffer) block_header{ nullptr, size, false };
+            _use_block(external_);
+        }
+    }
+    memory_arena(const memory_arena&) = delete;
+    memory_arena& operator=(const memory_arena&) = delete;
+    ~memory_arena() { release(); }
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        std::byte* p = _align(pos_, align);
+        if (!p || p + size > end_) {
+            size_t block_size = std::max(block_size_, sizeof(block_header) + size + align);
+            void* mem = std::malloc(block_size);
+            if (!mem) {
+                throw std::bad_alloc();
+            }
+            auto* block = new (mem) block_header{ block_, block_size, true };
+            _use_block(block);
+            p = _align(pos_, align);
+        }
+        last_ = p;
+        pos_ = p + size;
+        return p;
+    }
+
+    // resize the last allocation in place. returns false if addr is not the last allocation or there is no room.
+    bool resize(void* addr, size_t /*old_size*/, size_t new_size)
+    {
+        std::byte* p = (std::byte*)addr;
+        if (p != last_ || p + new_size > end_) {
+            return false;
+        }
+        pos_ = p + new_size;
+        return true;
+    }
+
+    // only the last allocation is actually freed.
+    void deallocate(void* addr, size_t /*size*/)
+    {
+        if (addr && addr == last_) {
+            pos_ = last_;
+            last_ = nullptr;
+        }
+    }
+
+    // free everything allocated so far. one block is kept for reuse.
+    // (the external buffer if given, otherwise the newest block)
+    void reset()
+    {
+        block_header* keep = external_ ? external_ : block_;
+        _free_blocks(keep);
+        if (keep) {
+            keep->prev = nullptr;
+            _use_block(keep);
+        }
+    }
+
+    // free all blocks.
+    void release()
+    {
+        _free_blocks(external_);
+        block_ = external_;
+        if (external_) {
+            _use_block(external_);
+        }
+        else {
+            pos_ = end_ = last_ = nullptr;
+        }
+    }
+
+    // the arena set by arena_scope on this thread, or the thread local default arena.
+    static memory_arena& current()
+    {
+        if (auto* r = _current()) {
+            return *r;
+        }
+        thread_local memory_arena s_default;
+        return s_default;
+    }
+
+    static memory_arena*& _current()
+    {
+        thread_local memory_arena* s_current = nullptr;
+        return s_current;
+    }
+
+private:
+    struct alignas(std::max_align_t) block_header
+    {
+        block_header* prev;
+        size_t size;
+        bool owned;
+    };
+
+    static std::byte* _align(std::byte* p, size_t align)
+    {
+        return (std::byte*)(((uintptr_t)p + (align - 1)) & ~(uintptr_t)(align - 1));
+    }
+
+    void _use_block(block_header* block)
+    {
+        block_ = block;
+        pos_ = (std::byte*)(block + 1);
+        end_ = (std::byte*)block + block->size;
+        last_ = nullptr;
+    }
+
+    void _free_blocks(block_header* keep)
+    {
+        for (block_header* b = block_; b; ) {
+            block_header* prev = b->prev;
+            if (b != keep && b->owned) {
+                std::free(b);
+            }
+            b = prev;
+        }
+    }
+
+    size_t block_size_;
+    block_header* block_ = nullptr;
+    block_header* external_ = nullptr;
+    std::byte* pos_ = nullptr;
+    std::byte* end_ = nullptr;
+    std::byte* last_ = nullptr;
+};
+
+// makes memory_arena::current() return the arena while in the scope. (per-request arena)
+class arena_scope
+{
+public:
+    explicit arena_scope(memory_arena& arena) : prev_(memory_arena::_current()) { memory_arena::_current() = &arena; }
+    ~arena_scope() { memory_arena::_current() = prev_; }
+    arena_scope(const arena_scope&) = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+
+private:
+    memory_arena* prev_;
+};
+
+// dynamic memory allocated from memory_arena::current() at the time the container is constructed.
+// the arena must outlive the container.
+// grows in place if the buffer is the last allocation of the arena.
+template<class T, class Growth = growth_2x>
+class arena_memory
+{
+public:
+    using value_type = T;
+    using growth_policy = Growth;
+    static constexpr bool is_dynamic_memory = true; // behaves same as dynamic_memory except allocator
+    static constexpr bool is_arena_memory = true;
+
+    memory_arena& arena() const noexcept { return *arena_; }
+
+protected:
+    T* _allocate(size_t size)
+    {
+        if (size == 0) {
+            return nullptr;
+        }
+        fc_memory_stats(arena_memory, _allocate(sizeof(T) * size, 0));
+        return (T*)arena_->allocate(sizeof(T) * size, alignof(T));
+    }
+
+    void _deallocate(void* addr)
+    {
+        fc_memory_stats(arena_memory, _deallocate(addr, 0));
+        arena_->deallocate(addr, sizeof(T) * capacity_);
+    }
+
+    template<class Move>
+    void _reallocate(size_t new_capaity, Move&& move)
+    {
+        if (capacity_ == new_capaity) {
+            return;
+        }
+        if (data_ && new_capaity != 0 && arena_->resize(data_, sizeof(T) * capacity_, sizeof(T) * new_capaity)) {
+            fc_memory_stats(arena_memory, _reallocate(sizeof(T) * new_capaity, 0, 0, false));
+            capacity_ = new_capaity;
+            return;
+        }
+        T* new_data = _allocate(new_capaity);
+        move(new_data);
+
+        _deallocate(data_);
+        data_ = new_data;
+        capacity_ = new_capaity;
+    }
+
+    // the memory belongs to the arena. it goes with the arena pointer.
+    void _swap(arena_memory& r) noexcept
+    {
+        std::swap(capacity_, r.capacity_);
+        std::swap(size_, r.size_);
+        std::swap(data_, r.data_);
+        std::swap(arena_, r.arena_);
+    }
+
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    T* data_ = nullptr;
+    memory_arena* arena_ = &memory_arena::current();
+};
+
 // "wrap" existing memory block.
 // similar to std::span, but it takes ownership.
 // that means, unlike std::span, mapped container have resize(), push_back() and insert().
@@ -0,0 +1,224 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// allocation statistics per memory model type. (e.g. dynamic_memory<int>, sbo_memory<char, 16>)
+// define FC_ENABLE_MEMORY_STATS (for all translation units) to enable. otherwise the hooks compile to nothing,
+// and the query functions return zeros.
+//
+// ist::get_memory_stats<ist::dynamic_memory<int>>().allocations;
+// ist::for_each_memory_stats([](std::string_view type, const ist::memory_stats& s) { ... });
+//
+// live & peak bytes are measured by the actual block size (malloc_usable_size() or equivalent) or committed pages,
+// so they are 0 on platforms where it is unknown, and are not tracked for arena_memory. (the arena owns the memory)
+
+#ifdef FC_ENABLE_MEMORY_STATS
+#   define fc_memory_stats(Memory, ...) ::ist::_get_memory_stats_counter<Memory>().__VA_ARGS__
+#else
+#   define fc_memory_stats(Memory, ...)
+#endif
+
+namespace ist {
+
+struct memory_stats
+{
+    size_t allocations = 0;          // new blocks
+    size_t deallocations = 0;
+    size_t reallocations = 0;        // realloc() or in place resize (arena, mmap, file)
+    size_t reallocation_moves = 0;   // realloc() returned a different address. (copied by the allocator, or pages remapped)
+    size_t reallocation_copies = 0;  // elements were copied to a new block by the container
+    size_t moved_elements = 0;       // total elements of reallocation_copies
+    size_t moved_bytes = 0;
+    size_t sbo_spills = 0;           // the internal buffer overflowed to heap
+    size_t bytes_requested = 0;      // total size of allocations and reallocations
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;
+};
+
+class _memory_stats_counter
+{
+public:
+    memory_stats get() const
+    {
+        memory_stats r;
+        r.allocations = allocations_.load(std::memory_order_relaxed);
+        r.deallocations = deallocations_.load(std::memory_order_relaxed);
+        r.reallocations = reallocations_.load(std::memory_order_relaxed);
+        r.reallocation_moves = reallocation_moves_.load(std::memory_order_relaxed);
+        r.reallocation_copies = reallocation_copies_.load(std::memory_order_relaxed);
+        r.moved_elements = moved_elements_.load(std::memory_order_relaxed);
+        r.moved_bytes = moved_bytes_.load(std::memory_order_relaxed);
+        r.sbo_spills = sbo_spills_.load(std::memory_order_relaxed);
+        r.bytes_requested = bytes_requested_.load(std::memory_order_relaxed);
+        r.live_bytes = live_bytes_.load(std::memory_order_relaxed);
+        r.peak_bytes = peak_bytes_.load(std::memory_order_relaxed);
+        return r;
+    }
+
+    // peak is reset to the current live bytes. live bytes are kept, because the blocks are still alive.
+    void reset()
+    {
+        for (auto* c : { &allocations_, &deallocations_, &reallocations_, &reallocation_moves_, &reallocation_copies_,
+                         &moved_elements_, &moved_bytes_, &sbo_spills_, &bytes_requested_ }) {
+            c->store(0, std::memory_order_relaxed);
+        }
+        peak_bytes_.store(live_bytes_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // hooks called by memory models
+    void _allocate(size_t bytes, size_t block_bytes)
+    {
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        bytes_requested_.fetch_add(bytes, std::memory_order_relaxed);
+        _add_live(block_bytes);
+    }
+    void _deallocate(const void* addr, size_t block_bytes)
+    {
+        if (addr) {
+            deallocations_.fetch_add(1, std::memory_order_relaxed);
+            live_bytes_.fetch_sub(block_bytes, std::memory_order_relaxed);
+        }
+    }
+    void _reallocate(size_t bytes, size_t old_block_bytes, size_t new_block_bytes, bool moved)
+    {
+        reallocations_.fetch_add(1, std::memory_order_relaxed);
+        if (moved) {
+            reallocation_moves_.fetch_add(1, std::memory_order_relaxed);
+        }
+        bytes_requested_.fetch_add(bytes, std::memory_order_relaxed);
+        live_bytes_.fetch_sub(old_block_bytes, std::memory_order_relaxed);
+        _add_live(new_block_bytes);
+    }
+    void _copy(size_t elements, size_t bytes)
+    {
+        if (elements == 0) {
+            return;
+        }
+        reallocation_copies_.fetch_add(1, std::memory_order_relaxed);
+        moved_elements_.fetch_add(elements, std::memory_order_relaxed);
+        moved_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void _spill()
+    {
+        sbo_spills_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    void _add_live(size_t bytes)
+    {
+        size_t live = live_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (live > peak && !peak_bytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    }
+
+    std::atomic<size_t> allocations_{ 0 };
+    std::atomic<size_t> deallocations_{ 0 };
+    std::atomic<size_t> reallocations_{ 0 };
+    std::atomic<size_t> reallocation_moves_{ 0 };
+    std::atomic<size_t> reallocation_copies_{ 0 };
+    std::atomic<size_t> moved_elements_{ 0 };
+    std::atomic<size_t> moved_bytes_{ 0 };
+    std::atomic<size_t> sbo_spills_{ 0 };
+    std::atomic<size_t> bytes_requested_{ 0 };
+    std::atomic<size_t> live_bytes_{ 0 };
+    std::atomic<size_t> peak_bytes_{ 0 };
+};
+
+// name of T from the compiler. e.g. "dynamic_memory<int>" (the format depends on the compiler)
+template<class T>
+inline std::string_view _type_name()
+{
+#if defined(_MSC_VER)
+    std::string_view s = __FUNCSIG__;
+    size_t begin = s.find("_type_name<") + 11;
+    size_t end = s.rfind(">(void)");
+#else
+    std::string_view s = __PRETTY_FUNCTION__;
+    size_t begin = s.find("T = ") + 4;
+    size_t end = s.find(';', begin);
+    if (end == std::string_view::npos) {
+        end = s.rfind(']');
+    }
+#endif
+    return s.substr(begin, end - begin);
+}
+
+struct _memory_stats_entry
+{
+    std::string_view type_name;
+    _memory_stats_counter* counter;
+};
+
+struct _memory_stats_registry
+{
+    std::mutex mutex;
+    std::vector<_memory_stats_entry> entries;
+
+    static _memory_stats_registry& instance()
+    {
+        static _memory_stats_registry s_instance;
+        return s_instance;
+    }
+};
+
+// counters are registered when they are touched first.
+template<class Memory>
+inline _memory_stats_counter& _get_memory_stats_counter()
+{
+    static _memory_stats_counter* s_counter = []() {
+        static _memory_stats_counter s_instance;
+        auto& reg = _memory_stats_registry::instance();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.entries.push_back({ _type_name<Memory>(), &s_instance });
+        return &s_instance;
+    }();
+    return *s_counter;
+}
+
+template<class Memory>
+inline memory_stats get_memory_stats()
+{
+#ifdef FC_ENABLE_MEMORY_STATS
+    return _get_memory_stats_counter<Memory>().get();
+#else
+    return {};
+#endif
+}
+
+template<class Memory>
+inline void reset_memory_stats()
+{
+#ifdef FC_ENABLE_MEMORY_STATS
+    _get_memory_stats_counter<Memory>().reset();
+#endif
+}
+
+// f(std::string_view type_name, const memory_stats& stats) for each memory model type that has been used.
+template<class F>
+inline void for_each_memory_stats(F&& f)
+{
+    auto& reg = _memory_stats_registry::instance();
+    std::vector<_memory_stats_entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        entries = reg.entries;
+    }
+    for (auto& e : entries) {
+        f(e.type_name, e.counter->get());
+    }
+}
+
+inline void reset_all_memory_stats()
+{
+    auto& reg = _memory_stats_registry::instance();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto& e : reg.entries) {
+        e.counter->reset();
+    }
+}
+
+} // namespace ist
@@ -2,9 +2,33 @@
 #include <cstring>
 #include <iostream>
 #include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <system_error>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <climits>
+#include "mapped_file.h"
+#if defined(_WIN32)
+#   include <io.h>
+#else
+#   include <sys/uio.h>
+#endif
 
 namespace ist {
 
+class _async_prefetch;
+class _flush_writer;
+
+struct memory_view_chunk
+{
+    const char* data;
+    size_t size;
+};
+
 class memory_view_streambuf : public std::streambuf
 {
     using super = std::streambuf;
@@ -12,6 +36,10 @@ public:
     using underflow_handler = std::function<bool(char*&, size_t&, char*&)>;
     using overflow_handler = std::function<bool(char*&, size_t&)>;
     using destroy_handler = std::function<void()>;
+    // fills dst and returns written size. returns 0 at the end of data.
+    using read_handler = std::function<size_t(char* dst, size_t size)>;
+    // receives filled chunks. returns false on error.
+    using flush_handler = std::function<bool(const memory_view_chunk* chunks, size_t num_chunks)>;
 
     memory_view_streambuf() = default;
     memory_view_streambuf(const void* data, size_t size);
@@ -31,6 +59,7 @@ public:
     int overflow(int c) override;
     std::streamsize xsgetn(char* ptr, std::streamsize count) override;
     std::streamsize xsputn(const char* ptr, std::streamsize count) override;
+    int sync() override;
 
     // extensions
     void swap(memory_view_streambuf& v) noexcept;
@@ -43,12 +72,45 @@ public:
     void set_overflow_handler(overflow_handler&& f) { on_overflow_ = std::move(f); }
     void set_destroy_handler(destroy_handler&& f) { on_destroy_ = std::move(f); }
 
+    // memory mapped file mode. reads / writes the file directly without read() / write() copies.
+    // open_file_for_write() extends the file on overflow (when no overflow handler is set),
+    // and close_file() truncates it to the written size.
+    bool open_file(const char* path);
+    bool open_file_for_write(const char* path, size_t reserve_size = 1024 * 1024);
+    void close_file();
+    bool is_file_open() const noexcept { return file_.is_open(); }
+
+    // asynchronous read mode. owns num_buffers buffers, and a background thread fills them with source
+    // while the consumer parses the current one. underflow just switches to the next filled buffer.
+    // this uses the underflow handler slot. (falls back to synchronous read if threads are not available)
+    // exceptions thrown by source are rethrown from underflow on the consumer's thread, in either mode.
+    void start_async_read(read_handler&& source, size_t buffer_size = 1024 * 1024, size_t num_buffers = 2);
+    void stop_async_read();
+
+    // flushing write mode. writes go to fixed size buffers, and full buffers are handed to sink instead of growing.
+    // sink is called with batch chunks at once (e.g. one writev() for multiple chunks), so memory usage is
+    // constant: buffer_size * batch. remaining data is flushed by flush_write(), std::ostream::flush() and on stop / destruction.
+    // this uses the overflow path in place of the overflow handler.
+    void start_flush_write(flush_handler&& sink, size_t buffer_size = 64 * 1024, size_t batch = 1);
+    bool flush_write();
+    void stop_flush_write();
+
 public:
     char* data_{};
     size_t size_ = 0;
     underflow_handler on_underflow_;
     overflow_handler on_overflow_;
     destroy_handler on_destroy_;
+    mapped_file file_;
+    size_t written_ = 0; // high water mark of put position in file write mode
+    std::unique_ptr<_async_prefetch> prefetch_;
+    std::unique_ptr<_flush_writer> flush_;
+
+private:
+    bool _grow_file();
+
+    friend class memory_view_reader;
+    friend class memory_view_writer;
 };
 
 class memory_view_stream : public std::iostream
@@ -58,6 +120,8 @@ public:
     using underflow_handler = memory_view_streambuf::underflow_handler;
     using overflow_handler = memory_view_streambuf::overflow_handler;
     using destroy_handler = memory_view_streambuf::destroy_handler;
+    using read_handler = memory_view_streambuf::read_handler;
+    using flush_handler = memory_view_streambuf::flush_handler;
 
     memory_view_stream();
     memory_view_stream(const void* data, size_t size);
@@ -78,11 +142,508 @@ public:
     void set_overflow_handler(overflow_handler&& f) { buf_.set_overflow_handler(std::move(f)); }
     void set_destroy_handler(destroy_handler&& f) { buf_.set_destroy_handler(std::move(f)); }
 
+    // set failbit on failure
+    bool open_file(const char* path) { return _check(buf_.open_file(path)); }
+    bool open_file_for_write(const char* path, size_t reserve_size = 1024 * 1024) { return _check(buf_.open_file_for_write(path, reserve_size)); }
+    void close_file() { buf_.close_file(); }
+    bool is_file_open() const noexcept { return buf_.is_file_open(); }
+
+    void start_async_read(read_handler&& source, size_t buffer_size = 1024 * 1024, size_t num_buffers = 2)
+    {
+        buf_.start_async_read(std::move(source), buffer_size, num_buffers);
+    }
+    void stop_async_read() { buf_.stop_async_read(); }
+
+    void start_flush_write(flush_handler&& sink, size_t buffer_size = 64 * 1024, size_t batch = 1)
+    {
+        buf_.start_flush_write(std::move(sink), buffer_size, batch);
+    }
+    bool flush_write() { return buf_.flush_write(); }
+    void stop_flush_write() { buf_.stop_flush_write(); }
+
 private:
+    bool _check(bool ok) { this->clear(ok ? std::ios::goodbit : std::ios::failbit); return ok; }
+
     memory_view_streambuf buf_;
 };
 
 
+// lightweight binary reader. no sentry, no virtual call and no locale on the fast path.
+// reads directly from the buffer, and falls back to memory_view_streambuf (its underflow handler) only at buffer boundaries.
+// read position is written back to the streambuf on sync() and destruction, so it can be mixed with memory_view_stream.
+// T must be trivially copyable.
+class memory_view_reader
+{
+public:
+    memory_view_reader() = default;
+    explicit memory_view_reader(memory_view_streambuf& buf);
+    explicit memory_view_reader(memory_view_stream& stream) : memory_view_reader(*stream.rdbuf()) {}
+    memory_view_reader(const void* data, size_t size);
+    ~memory_view_reader() { sync(); }
+    memory_view_reader(const memory_view_reader& v) = delete;
+    memory_view_reader& operator=(const memory_view_reader& v) = delete;
+
+    template<class T>
+    bool read(T& dst)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (size_t(end_ - cur_) >= sizeof(T)) {
+            std::memcpy(&dst, cur_, sizeof(T));
+            cur_ += sizeof(T);
+            return true;
+        }
+        return _read_slow(&dst, sizeof(T)) == sizeof(T);
+    }
+    // returns T() on failure (eof() tells it)
+    template<class T>
+    T read()
+    {
+        T ret{};
+        read(ret);
+        return ret;
+    }
+    // returns number of elements read
+    template<class T>
+    size_t read_span(T* dst, size_t n)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return read_bytes(dst, sizeof(T) * n) / sizeof(T);
+    }
+    size_t read_bytes(void* dst, size_t size)
+    {
+        if (size_t(end_ - cur_) >= size) {
+            std::memcpy(dst, cur_, size);
+            cur_ += size;
+            return size;
+        }
+        return _read_slow(dst, size);
+    }
+
+    // read without advancing. fails if the value crosses buffer boundary.
+    template<class T>
+    bool peek(T& dst) const
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (size_t(end_ - cur_) >= sizeof(T)) {
+            std::memcpy(&dst, cur_, sizeof(T));
+            return true;
+        }
+        return false;
+    }
+
+    // LEB128
+    bool read_varint(uint64_t& dst);
+    // zigzag + LEB128
+    bool read_varint(int64_t& dst)
+    {
+        uint64_t v;
+        if (!read_varint(v)) {
+            return false;
+        }
+        dst = int64_t(v >> 1) ^ -int64_t(v & 1);
+        return true;
+    }
+
+    bool skip(size_t size);
+    // write read position back to the streambuf
+    void sync();
+
+    // true if a read failed by end of data
+    bool eof() const noexcept { return eof_; }
+    // remaining bytes in current buffer
+    size_t remaining() const noexcept { return end_ - cur_; }
+    const char* position() const noexcept { return cur_; }
+
+private:
+    size_t _read_slow(void* dst, size_t size);
+
+    memory_view_streambuf* buf_ = nullptr;
+    const char* cur_ = nullptr;
+    const char* end_ = nullptr;
+    bool eof_ = false;
+};
+
+// lightweight binary writer. the counterpart of memory_view_reader.
+// falls back to memory_view_streambuf (its overflow handler or file extension) only at buffer boundaries.
+class memory_view_writer
+{
+public:
+    memory_view_writer() = default;
+    explicit memory_view_writer(memory_view_streambuf& buf);
+    explicit memory_view_writer(memory_view_stream& stream) : memory_view_writer(*stream.rdbuf()) {}
+    memory_view_writer(void* data, size_t size);
+    ~memory_view_writer() { sync(); }
+    memory_view_writer(const memory_view_writer& v) = delete;
+    memory_view_writer& operator=(const memory_view_writer& v) = delete;
+
+    template<class T>
+    bool write(const T& src)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (size_t(end_ - cur_) >= sizeof(T)) {
+            std::memcpy(cur_, &src, sizeof(T));
+            cur_ += sizeof(T);
+            return true;
+        }
+        return _write_slow(&src, sizeof(T)) == sizeof(T);
+    }
+    template<class T>
+    size_t write_span(const T* src, size_t n)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return write_bytes(src, sizeof(T) * n) / sizeof(T);
+    }
+    size_t write_bytes(const void* src, size_t size)
+    {
+        if (size_t(end_ - cur_) >= size) {
+            std::memcpy(cur_, src, size);
+            cur_ += size;
+            return size;
+        }
+        return _write_slow(src, size);
+    }
+
+    // LEB128
+    bool write_varint(uint64_t v);
+    // zigzag + LEB128
+    bool write_varint(int64_t v)
+    {
+        return write_varint((uint64_t(v) << 1) ^ uint64_t(v >> 63));
+    }
+
+    // write put position back to the streambuf
+    void sync();
+
+    // true if a write failed
+    bool full() const noexcept { return full_; }
+    size_t remaining() const noexcept { return end_ - cur_; }
+    char* position() const noexcept { return cur_; }
+
+private:
+    size_t _write_slow(const void* src, size_t size);
+
+    memory_view_streambuf* buf_ = nullptr;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    bool full_ = false;
+};
+
+
+// ring of buffers filled by a background thread. (see memory_view_streambuf::start_async_read())
+class _async_prefetch
+{
+public:
+    using read_handler = memory_view_streambuf::read_handler;
+
+    _async_prefetch(read_handler&& source, size_t buffer_size, size_t num_buffers)
+        : source_(std::move(source))
+        , buffer_size_(buffer_size)
+        , buffers_(std::max<size_t>(num_buffers, 2))
+        , free_(buffers_.size())
+    {
+        for (auto& b : buffers_) {
+            b.data.reset(new char[buffer_size_]);
+        }
+        try {
+            thread_ = std::thread([this]() { _produce(); });
+        }
+        catch (const std::system_error&) {
+            // no threads. next() reads synchronously.
+        }
+    }
+
+    ~_async_prefetch()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // release current buffer and wait for next one. returns false at the end of data.
+    bool next(char*& data, size_t& size)
+    {
+        if (!thread_.joinable()) {
+            size = source_ ? source_(buffers_[0].data.get(), buffer_size_) : 0;
+            data = buffers_[0].data.get();
+            return size != 0;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (holding_) {
+            holding_ = false;
+            ++free_;
+            cond_.notify_all();
+        }
+        cond_.wait(lock, [this]() { return ready_ > 0; });
+        auto& b = buffers_[head_];
+        if (b.size == 0) {
+            // end of data or error. keep it ready so that subsequent calls also fail.
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return false;
+        }
+        head_ = (head_ + 1) % buffers_.size();
+        --ready_;
+        holding_ = true;
+        data = b.data.get();
+        size = b.size;
+        return true;
+    }
+
+private:
+    struct buffer
+    {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+    };
+
+    void _produce()
+    {
+        for (;;) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this]() { return stop_ || free_ > 0; });
+                if (stop_) {
+                    return;
+                }
+                index = tail_;
+            }
+
+            // fill outside the lock. the consumer never touches free buffers.
+            auto& b = buffers_[index];
+            try {
+                b.size = source_(b.data.get(), buffer_size_);
+            }
+            catch (...) {
+                // rethrown by next() on the consumer's thread, same as reading synchronously.
+                b.size = 0;
+                error_ = std::current_exception();
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                tail_ = (tail_ + 1) % buffers_.size();
+                --free_;
+                ++ready_;
+            }
+            cond_.notify_all();
+            if (b.size == 0) {
+                return;
+            }
+        }
+    }
+
+    read_handler source_;
+    size_t buffer_size_ = 0;
+    std::vector<buffer> buffers_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    size_t free_ = 0;   // buffers the producer can fill
+    size_t ready_ = 0;  // filled buffers not consumed yet
+    size_t head_ = 0;   // next buffer to consume
+    size_t tail_ = 0;   // next buffer to fill
+    bool holding_ = false; // consumer is parsing buffers_[head_ - 1]
+    bool stop_ = false;
+    std::exception_ptr error_; // thrown by source_. set before the last buffer gets ready
+};
+
+
+// fixed size buffers for flushing write mode. (see memory_view_streambuf::start_flush_write())
+class _flush_writer
+{
+public:
+    using flush_handler = memory_view_streambuf::flush_handler;
+
+    _flush_writer(flush_handler&& sink, size_t buffer_size, size_t batch)
+        : sink_(std::move(sink))
+        , buffer_size_(buffer_size)
+        , buffers_(std::max<size_t>(batch, 1))
+        , chunks_(buffers_.size())
+    {
+        for (auto& b : buffers_) {
+            b.reset(new char[buffer_size_]);
+        }
+    }
+
+    char* buffer() const { return buffers_[index_].get(); }
+    size_t buffer_size() const { return buffer_size_; }
+
+    // current buffer is full. switch to next buffer, and hand chunks to the sink if all buffers are used.
+    bool next(size_t used)
+    {
+        chunks_[index_] = { buffers_[index_].get(), used };
+        if (++index_ < buffers_.size()) {
+            return true;
+        }
+        index_ = 0;
+        return sink_(chunks_.data(), chunks_.size());
+    }
+
+    // hand all pending data to the sink, including partially filled current buffer.
+    bool flush(size_t used)
+    {
+        size_t n = index_;
+        if (used) {
+            chunks_[n++] = { buffers_[index_].get(), used };
+        }
+        index_ = 0;
+        return n == 0 || sink_(chunks_.data(), n);
+    }
+
+private:
+    flush_handler sink_;
+    size_t buffer_size_ = 0;
+    std::vector<std::unique_ptr<char[]>> buffers_;
+    std::vector<memory_view_chunk> chunks_;
+    size_t index_ = 0;
+};
+
+// sink of flushing write mode that writes to a file descriptor. multiple chunks are written by one writev().
+inline memory_view_streambuf::flush_handler make_fd_flush_handler(int fd)
+{
+    return [fd](const memory_view_chunk* chunks, size_t num_chunks) -> bool {
+#if defined(_WIN32)
+        for (size_t i = 0; i < num_chunks; ++i) {
+            const char* src = chunks[i].data;
+            size_t remain = chunks[i].size;
+            while (remain) {
+                int r = ::_write(fd, src, (unsigned int)std::min<size_t>(remain, INT_MAX));
+                if (r <= 0) {
+                    return false;
+                }
+                src += r;
+                remain -= r;
+            }
+        }
+        return true;
+#else
+        constexpr size_t max_iov = 64;
+        iovec iov[max_iov];
+        size_t i = 0;
+        while (i < num_chunks) {
+            size_t n = std::min(num_chunks - i, max_iov);
+            for (size_t j = 0; j < n; ++j) {
+                iov[j] = { (void*)chunks[i + j].data, chunks[i + j].size };
+            }
+            // handle partial writes
+            iovec* cur = iov;
+            while (n) {
+                ssize_t r = ::writev(fd, cur, (int)n);
+                if (r < 0) {
+                    return false;
+                }
+                while (n && (size_t)r >= cur->iov_len) {
+                    r -= cur->iov_len;
+                    ++cur;
+                    --n;
+                    ++i;
+                }
+                if (n) {
+                    cur->iov_base = (char*)cur->iov_base + r;
+                    cur->iov_len -= r;
+                }
+            }
+        }
+        return true;
+#endif
+    };
+}
+
+// lock-free single producer single consumer queue of chunks. sink of flushing write mode.
+// chunks are copied into preallocated slots, so the writer's buffer can be reused immediately.
+// the producer waits while the queue is full, so memory usage is bounded.
+class chunk_queue
+{
+public:
+    chunk_queue(size_t chunk_size, size_t capacity)
+        : chunk_size_(chunk_size)
+        , capacity_(capacity)
+        , storage_(new char[chunk_size * capacity])
+        , sizes_(new size_t[capacity])
+    {
+    }
+
+    // producer side
+
+    void push(const char* data, size_t size)
+    {
+        while (size) {
+            size_t t = tail_.load(std::memory_order_relaxed);
+            while (t - head_.load(std::memory_order_acquire) == capacity_) {
+                std::this_thread::yield();
+            }
+            size_t n = std::min(size, chunk_size_);
+            size_t slot = t % capacity_;
+            std::memcpy(storage_.get() + chunk_size_ * slot, data, n);
+            sizes_[slot] = n;
+            tail_.store(t + 1, std::memory_order_release);
+            data += n;
+            size -= n;
+        }
+    }
+    // tell the consumer that no more chunks come
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    memory_view_streambuf::flush_handler handler()
+    {
+        return [this](const memory_view_chunk* chunks, size_t num_chunks) {
+            for (size_t i = 0; i < num_chunks; ++i) {
+                push(chunks[i].data, chunks[i].size);
+            }
+            return true;
+        };
+    }
+
+    // consumer side
+
+    // returns false if empty. the chunk is valid until pop().
+    bool front(memory_view_chunk& dst) const
+    {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        size_t slot = h % capacity_;
+        dst = { storage_.get() + chunk_size_ * slot, sizes_[slot] };
+        return true;
+    }
+    // waits for a chunk. returns false if closed and empty.
+    bool wait_front(memory_view_chunk& dst) const
+    {
+        for (;;) {
+            if (front(dst)) {
+                return true;
+            }
+            if (closed_.load(std::memory_order_acquire)) {
+                return front(dst);
+            }
+            std::this_thread::yield();
+        }
+    }
+    void pop()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    size_t chunk_size_;
+    size_t capacity_;
+    std::unique_ptr<char[]> storage_;
+    std::unique_ptr<size_t[]> sizes_;
+    alignas(64) std::atomic<size_t> head_{ 0 };
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+    std::atomic<bool> closed_{ false };
+};
+
+
 #pragma region impl
 inline memory_view_streambuf::memory_view_streambuf(const void* data, size_t size)
 {
@@ -94,6 +655,9 @@ inline memory_view_streambuf::~memory_view_streambuf()
     if (on_destroy_) {
         on_destroy_();
     }
+    close_file();
+    stop_async_read();
+    stop_flush_write();
 }
 
 inline memory_view_streambuf::pos_type
@@ -105,6 +669,7 @@ memory_view_streambuf::seekoff(off_type off, std::ios::seekdir dir, std::ios::op
     if (mode & std::ios::out)
     {
         char* current = this->pptr();
+        written_ = std::max(written_, size_t(current - head));
 
         if (dir == std::ios::beg)
             current = head + off;
@@ -146,14 +711,15 @@ memory_view_streambuf::underflow()
     char* cur = this->gptr();
     if (cur < tail) {
         // buffer is not exhausted yet. just update position.
-        int ret = *cur++;
+        int ret = traits_type::to_int_type(*cur++);
         this->setg(cur, cur, tail);
         return ret;
     }
     else {
         // call underflow handler. update buffer and position if handled properly.
         if (on_underflow_ && on_underflow_(data_, size_, cur)) {
-            this->setg(cur, cur, tail);
+            // handler may replace the buffer
+            this->setg(cur, cur, data_ + size_);
             return 0;
         }
         else {
@@ -176,16 +742,27 @@ memory_view_streambuf::overflow(int c)
     else {
         // call overflow handler. update buffer and position if handled properly.
         size_t old = size_;
-        if (on_overflow_ && on_overflow_(data_, size_)) {
+        if ((on_overflow_ && on_overflow_(data_, size_)) || _grow_file()) {
             cur = data_ + old;
             *cur++ = (char)c;
             this->setp(cur, data_ + size_);
         }
+        else if (flush_) {
+            // hand the full buffer to the sink and start over
+            bool ok = flush_->next(size_t(cur - head));
+            reset(flush_->buffer(), flush_->buffer_size());
+            if (!ok) {
+                return traits_type::eof();
+            }
+            cur = data_;
+            *cur++ = (char)c;
+            this->setp(cur, data_ + size_);
+        }
         else {
             return traits_type::eof();
         }
     }
-    return c;
+    return traits_type::not_eof(c);
 }
 
 // std::streambuf implements xsgetn() and xsputn().
@@ -237,7 +814,7 @@ memory_view_streambuf::xsputn(const char* src, std::streamsize count)
         this->setp(dst, tail);
 
         if (remain) {
-            if (overflow(*src++) == traits_type::eof()) {
+            if (overflow(traits_type::to_int_type(*src++)) == traits_type::eof()) {
                 return count - remain;
             }
             --remain;
@@ -249,6 +826,15 @@ memory_view_streambuf::xsputn(const char* src, std::streamsize count)
     return count;
 }
 
+inline int
+memory_view_streambuf::sync()
+{
+    if (flush_) {
+        return flush_write() ? 0 : -1;
+    }
+    return 0;
+}
+
 inline void
 memory_view_streambuf::swap(memory_view_streambuf& v) noexcept
 {
@@ -258,6 +844,10 @@ memory_view_streambuf::swap(memory_view_streambuf& v) noexcept
     std::swap(on_underflow_, v.on_underflow_);
     std::swap(on_overflow_, v.on_overflow_);
     std::swap(on_destroy_, v.on_destroy_);
+    file_.swap(v.file_);
+    std::swap(written_, v.written_);
+    std::swap(prefetch_, v.prefetch_);
+    std::swap(flush_, v.flush_);
 }
 
 
@@ -270,6 +860,119 @@ memory_view_streambuf::reset(const void* data, size_t size)
     this->setg(data_, data_, data_ + size_);
 }
 
+inline bool
+memory_view_streambuf::open_file(const char* path)
+{
+    close_file();
+    if (!file_.open(path, file_open_mode::open, false)) {
+        return false;
+    }
+    file_.advise_sequential();
+    reset(file_.data(), file_.size());
+    // read only. writes fail with eof instead of touching read only pages.
+    this->setp(data_ + size_, data_ + size_);
+    return true;
+}
+
+inline bool
+memory_view_streambuf::open_file_for_write(const char* path, size_t reserve_size)
+{
+    close_file();
+    if (!file_.open(path, file_open_mode::create, true) || !file_.resize(reserve_size)) {
+        file_.close();
+        return false;
+    }
+    reset(file_.data(), file_.size());
+    return true;
+}
+
+inline void
+memory_view_streambuf::close_file()
+{
+    if (!file_.is_open()) {
+        return;
+    }
+    if (file_.writable()) {
+        size_t written = std::max(written_, size_t(this->pptr() - data_));
+        file_.resize(written);
+    }
+    file_.close();
+    written_ = 0;
+    reset(nullptr, 0);
+}
+
+inline void
+memory_view_streambuf::start_async_read(read_handler&& source, size_t buffer_size, size_t num_buffers)
+{
+    stop_async_read();
+    prefetch_ = std::make_unique<_async_prefetch>(std::move(source), buffer_size, num_buffers);
+    // _async_prefetch is heap allocated, so the pointer stays valid even if this streambuf is moved or swapped.
+    on_underflow_ = [p = prefetch_.get()](char*& data, size_t& size, char*& cur) {
+        if (!p->next(data, size)) {
+            return false;
+        }
+        cur = data;
+        return true;
+    };
+    reset(nullptr, 0);
+}
+
+inline void
+memory_view_streambuf::stop_async_read()
+{
+    if (prefetch_) {
+        on_underflow_ = {};
+        prefetch_.reset();
+        reset(nullptr, 0);
+    }
+}
+
+inline void
+memory_view_streambuf::start_flush_write(flush_handler&& sink, size_t buffer_size, size_t batch)
+{
+    stop_flush_write();
+    flush_ = std::make_unique<_flush_writer>(std::move(sink), buffer_size, batch);
+    reset(flush_->buffer(), flush_->buffer_size());
+}
+
+inline bool
+memory_view_streambuf::flush_write()
+{
+    if (!flush_) {
+        return false;
+    }
+    bool ok = flush_->flush(size_t(this->pptr() - data_));
+    reset(flush_->buffer(), flush_->buffer_size());
+    return ok;
+}
+
+inline void
+memory_view_streambuf::stop_flush_write()
+{
+    if (flush_) {
+        flush_write();
+        flush_.reset();
+        reset(nullptr, 0);
+    }
+}
+
+inline bool
+memory_view_streambuf::_grow_file()
+{
+    if (!file_.writable()) {
+        return false;
+    }
+    // remap may move the address. keep get position.
+    size_t gpos = this->gptr() - data_;
+    if (!file_.resize(std::max<size_t>(size_ * 2, 4096))) {
+        return false;
+    }
+    data_ = (char*)file_.data();
+    size_ = file_.size();
+    this->setg(data_ + gpos, data_ + gpos, data_ + size_);
+    return true;
+}
+
 
 inline memory_view_stream::memory_view_stream()
     : super(&buf_)
@@ -300,6 +1003,148 @@ memory_view_stream::swap(memory_view_stream& v) noexcept
     super::swap(v);
     buf_.swap(v.buf_);
 }
+inline memory_view_reader::memory_view_reader(memory_view_streambuf& buf)
+    : buf_(&buf), cur_(buf.gptr()), end_(buf.egptr())
+{
+}
+
+inline memory_view_reader::memory_view_reader(const void* data, size_t size)
+    : cur_((const char*)data), end_((const char*)data + size)
+{
+}
+
+inline void
+memory_view_reader::sync()
+{
+    if (buf_) {
+        char* cur = const_cast<char*>(cur_);
+        buf_->setg(cur, cur, const_cast<char*>(end_));
+    }
+}
+
+inline size_t
+memory_view_reader::_read_slow(void* dst, size_t size)
+{
+    size_t ret;
+    if (buf_) {
+        sync();
+        ret = (size_t)buf_->memory_view_streambuf::xsgetn((char*)dst, (std::streamsize)size);
+        cur_ = buf_->gptr();
+        end_ = buf_->egptr();
+    }
+    else {
+        ret = std::min(size, size_t(end_ - cur_));
+        std::memcpy(dst, cur_, ret);
+        cur_ += ret;
+    }
+    if (ret != size) {
+        eof_ = true;
+    }
+    return ret;
+}
+
+inline bool
+memory_view_reader::read_varint(uint64_t& dst)
+{
+    uint64_t v = 0;
+    if (end_ - cur_ >= 10) {
+        // whole value is in the buffer. no boundary check per byte.
+        const uint8_t* p = (const uint8_t*)cur_;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = *p++;
+            v |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                cur_ = (const char*)p;
+                dst = v;
+                return true;
+            }
+        }
+        return false; // malformed
+    }
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b;
+        if (!read(b)) {
+            return false;
+        }
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            dst = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool
+memory_view_reader::skip(size_t size)
+{
+    if (size_t(end_ - cur_) >= size) {
+        cur_ += size;
+        return true;
+    }
+    char tmp[256];
+    while (size) {
+        size_t n = std::min(size, sizeof(tmp));
+        if (_read_slow(tmp, n) != n) {
+            return false;
+        }
+        size -= n;
+    }
+    return true;
+}
+
+
+inline memory_view_writer::memory_view_writer(memory_view_streambuf& buf)
+    : buf_(&buf), cur_(buf.pptr()), end_(buf.epptr())
+{
+}
+
+inline memory_view_writer::memory_view_writer(void* data, size_t size)
+    : cur_((char*)data), end_((char*)data + size)
+{
+}
+
+inline void
+memory_view_writer::sync()
+{
+    if (buf_) {
+        buf_->setp(cur_, end_);
+    }
+}
+
+inline size_t
+memory_view_writer::_write_slow(const void* src, size_t size)
+{
+    size_t ret;
+    if (buf_) {
+        sync();
+        ret = (size_t)buf_->memory_view_streambuf::xsputn((const char*)src, (std::streamsize)size);
+        cur_ = buf_->pptr();
+        end_ = buf_->epptr();
+    }
+    else {
+        ret = std::min(size, size_t(end_ - cur_));
+        std::memcpy(cur_, src, ret);
+        cur_ += ret;
+    }
+    if (ret != size) {
+        full_ = true;
+    }
+    return ret;
+}
+
+inline bool
+memory_view_writer::write_varint(uint64_t v)
+{
+    uint8_t tmp[10];
+    size_t n = 0;
+    do {
+        uint8_t b = uint8_t(v & 0x7f);
+        v >>= 7;
+        tmp[n++] = v ? (b | 0x80) : b;
+    } while (v);
+    return write_bytes(tmp, n) == n;
+}
 #pragma endregion impl
 
 } // namespace ist
@@ -0,0 +1,367 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+#include "vector.h"
+#include "raw_vector.h"
+#include "flat_map.h"
+#include "flat_set.h"
+#include "mapped_file.h"
+
+
+namespace ist {
+
+enum mmap_flags : uint32_t
+{
+    mmap_default = 0,
+    // transparent huge pages (MADV_HUGEPAGE). just a hint. the range is aligned to 2MB to make it effective.
+    mmap_huge_page = 1,
+    // explicit huge pages (MAP_HUGETLB). requires pre-allocated huge pages, and allocation fails without them.
+    // not supported on Windows (large pages can't be committed partially).
+    mmap_hugetlb = 2,
+};
+
+constexpr size_t _huge_page_size = 2 * 1024 * 1024;
+
+inline size_t _vm_page_size()
+{
+#if defined(_WIN32)
+    static const size_t s_size = []() { SYSTEM_INFO info; ::GetSystemInfo(&info); return (size_t)info.dwPageSize; }();
+#else
+    static const size_t s_size = (size_t)::sysconf(_SC_PAGESIZE);
+#endif
+    return s_size;
+}
+
+// reserve address range. nothing is accessible until committed.
+inline void* _vm_reserve(size_t size, uint32_t flags)
+{
+#if defined(_WIN32)
+    (void)flags;
+    return ::VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    int mflags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#if defined(MAP_HUGETLB)
+    if (flags & mmap_hugetlb) {
+        void* r = ::mmap(nullptr, size, PROT_NONE, mflags | MAP_HUGETLB, -1, 0);
+        return r == MAP_FAILED ? nullptr : r;
+    }
+#endif
+    if (flags & mmap_huge_page) {
+        // over-reserve and trim to align the range to huge page size
+        size_t extra = _huge_page_size;
+        void* r = ::mmap(nullptr, size + extra, PROT_NONE, mflags, -1, 0);
+        if (r == MAP_FAILED) {
+            return nullptr;
+        }
+        std::byte* begin = (std::byte*)r;
+        std::byte* aligned = (std::byte*)(((uintptr_t)begin + (extra - 1)) & ~(uintptr_t)(extra - 1));
+        if (aligned != begin) {
+            ::munmap(begin, aligned - begin);
+        }
+        if (size_t tail = (begin + size + extra) - (aligned + size)) {
+            ::munmap(aligned + size, tail);
+        }
+#if defined(MADV_HUGEPAGE)
+        ::madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        return aligned;
+    }
+    void* r = ::mmap(nullptr, size, PROT_NONE, mflags, -1, 0);
+    return r == MAP_FAILED ? nullptr : r;
+#endif
+}
+
+inline bool _vm_commit(void* addr, size_t size)
+{
+#if defined(_WIN32)
+    return ::VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return ::mprotect(addr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+// give physical memory back to the OS. the range stays reserved.
+inline void _vm_decommit(void* addr, size_t size)
+{
+#if defined(_WIN32)
+    ::VirtualFree(addr, size, MEM_DECOMMIT);
+#else
+    ::madvise(addr, size, MADV_DONTNEED);
+    ::mprotect(addr, size, PROT_NONE);
+#endif
+}
+
+inline void _vm_release(void* addr, size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    ::VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    ::munmap(addr, size);
+#endif
+}
+
+
+// reserves ReserveSize bytes of address space at the first allocation, and commits pages as the container grows.
+// data never moves, so growth never copies. shrink_to_fit() returns pages to the OS.
+// address space is cheap on 64 bit systems, so ReserveSize can be much larger than actual usage.
+// for very large containers. each container takes at least one page.
+template<class T, size_t ReserveSize = (size_t(1) << 36), uint32_t Flags = mmap_default>
+class mmap_memory
+{
+public:
+    using value_type = T;
+    using growth_policy = growth_2x; // growth is cheap, but reduces syscalls
+    static constexpr bool is_dynamic_memory = true; // behaves same as dynamic_memory except allocator
+    static constexpr bool is_mmap_memory = true;
+    static constexpr size_t reserve_size = ReserveSize;
+
+protected:
+    static size_t _granularity()
+    {
+        return (Flags & mmap_hugetlb) ? _huge_page_size : _vm_page_size();
+    }
+    static size_t _round_up(size_t bytes)
+    {
+        size_t g = _granularity();
+        return (bytes + (g - 1)) / g * g;
+    }
+
+    // each allocation reserves its own range. (used by containers that don't use _reallocate())
+    T* _allocate(size_t size)
+    {
+        if (size == 0) {
+            return nullptr;
+        }
+        size_t bytes = _round_up(sizeof(T) * size);
+        if (bytes > ReserveSize) {
+            throw std::bad_alloc();
+        }
+        void* r = _vm_reserve(ReserveSize, Flags);
+        if (!r || !_vm_commit(r, bytes)) {
+            throw std::bad_alloc();
+        }
+        // the committed size is unknown at _deallocate(). live bytes are tracked only by _reallocate().
+        fc_memory_stats(mmap_memory, _allocate(bytes, 0));
+        return (T*)r;
+    }
+
+    void _deallocate(void* addr)
+    {
+        if (addr) {
+            fc_memory_stats(mmap_memory, _deallocate(addr, 0));
+            _vm_release(addr, ReserveSize);
+        }
+    }
+
+    template<class Move>
+    void _reallocate(size_t new_capaity, Move&& /*move*/)
+    {
+        if (capacity_ == new_capaity) {
+            return;
+        }
+        if (new_capaity == 0) {
+            fc_memory_stats(mmap_memory, _deallocate(data_, _round_up(sizeof(T) * capacity_)));
+            _vm_release(data_, ReserveSize);
+            data_ = nullptr;
+            capacity_ = 0;
+            return;
+        }
+
+        size_t new_bytes = _round_up(sizeof(T) * new_capaity);
+        if (new_bytes > ReserveSize) {
+            throw std::bad_alloc();
+        }
+        if (!data_) {
+            // size_ is always 0 here. nothing to move.
+            data_ = (T*)_vm_reserve(ReserveSize, Flags);
+            if (!data_) {
+                throw std::bad_alloc();
+            }
+        }
+
+        // committed range is always page aligned, so it can be derived from capacity_
+        size_t bytes = _round_up(sizeof(T) * capacity_);
+        if (new_bytes > bytes) {
+            if (!_vm_commit((std::byte*)data_ + bytes, new_bytes - bytes)) {
+                throw std::bad_alloc();
+            }
+        }
+        else if (new_bytes < bytes) {
+            _vm_decommit((std::byte*)data_ + new_bytes, bytes - new_bytes);
+        }
+        if (capacity_ == 0) {
+            fc_memory_stats(mmap_memory, _allocate(new_bytes, new_bytes));
+        }
+        else {
+            fc_memory_stats(mmap_memory, _reallocate(new_bytes, bytes, new_bytes, false));
+        }
+        capacity_ = new_bytes / sizeof(T);
+    }
+
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    T* data_ = nullptr;
+};
+
+
+template<class T, size_t ReserveSize = (size_t(1) << 36), uint32_t Flags = mmap_default>
+using mmap_vector = basic_vector<T, mmap_memory<T, ReserveSize, Flags>>;
+
+template<class T, size_t ReserveSize = (size_t(1) << 36), uint32_t Flags = mmap_default>
+using mmap_raw_vector = basic_raw_vector<T, mmap_memory<T, ReserveSize, Flags>>;
+
+
+
+// header at the beginning of files of file_mapped_memory. elements follow it.
+struct file_mapped_header
+{
+    static constexpr uint32_t magic_value = 0x4d464346; // "FCFM"
+    static constexpr uint32_t current_version = 1;
+
+    uint32_t magic = magic_value;
+    uint32_t version = current_version;
+    uint32_t elem_size = 0;
+    uint32_t elem_align = 0;
+    uint64_t size = 0; // number of elements
+    uint8_t reserved[40]{};
+};
+static_assert(sizeof(file_mapped_header) == 64);
+
+// memory mapped file. the file is extended (ftruncate + remap) as the container grows,
+// and the content survives the container. reopening the file is O(1); there is no parse step.
+// size is written to the file header on sync() and on close. sync() also flushes pages to the storage.
+// elements must be trivially copyable (or trivially relocatable) and must not contain pointers.
+// growth remaps the file, so pointers & iterators are invalidated as usual.
+template<class T>
+class file_mapped_memory
+{
+public:
+    using value_type = T;
+    using growth_policy = growth_2x;
+    static constexpr bool is_dynamic_memory = true;
+    static constexpr bool is_file_mapped_memory = true;
+    static constexpr size_t data_offset = sizeof(file_mapped_header);
+
+    static_assert(is_pointer_free_v<T>, "file_mapped_memory requires trivially copyable types without pointers");
+    static_assert(alignof(T) <= data_offset);
+
+    file_mapped_memory() {}
+    explicit file_mapped_memory(const char* path, file_open_mode mode = file_open_mode::open_or_create)
+    {
+        open(path, mode);
+    }
+    ~file_mapped_memory()
+    {
+        close();
+    }
+    file_mapped_memory(const file_mapped_memory&) = delete;
+    file_mapped_memory& operator=(const file_mapped_memory&) = delete;
+
+    void open(const char* path, file_open_mode mode = file_open_mode::open_or_create)
+    {
+        close();
+        if (!file_.open(path, mode, true)) {
+            throw std::runtime_error(std::string("file_mapped_memory: failed to open ") + path);
+        }
+        if (file_.size() == 0) {
+            // new file
+            _resize_file(data_offset);
+            *_header() = file_mapped_header{};
+            _header()->elem_size = sizeof(T);
+            _header()->elem_align = alignof(T);
+        }
+        else {
+            // too small to have the header: not ours. don't overwrite it.
+            auto* header = _header();
+            if (file_.size() < data_offset || header->magic != file_mapped_header::magic_value || header->version != file_mapped_header::current_version ||
+                header->elem_size != sizeof(T) || header->elem_align != alignof(T))
+            {
+                // close without writing the header back
+                file_.close();
+                throw std::runtime_error(std::string("file_mapped_memory: format mismatch ") + path);
+            }
+            data_ = (T*)(file_.data() + data_offset);
+        }
+        capacity_ = (file_.size() - data_offset) / sizeof(T);
+        size_ = std::min((size_t)_header()->size, capacity_);
+    }
+
+    void close()
+    {
+        if (file_.data()) {
+            _header()->size = size_;
+        }
+        file_.close();
+        capacity_ = size_ = 0;
+        data_ = nullptr;
+    }
+
+    bool is_open() const noexcept { return file_.is_open(); }
+
+    // write size to the header and flush mapped pages to the storage.
+    void sync() const
+    {
+        if (file_.data()) {
+            _header()->size = size_;
+            file_.sync();
+        }
+    }
+
+protected:
+    template<class Move>
+    void _reallocate(size_t new_capaity, Move&& /*move*/)
+    {
+        if (capacity_ == new_capaity) {
+            return;
+        }
+        if (!is_open()) {
+            throw std::runtime_error("file_mapped_memory: file is not opened");
+        }
+        // content is carried by the file. nothing to move.
+#ifdef FC_ENABLE_MEMORY_STATS
+        T* old_data = data_;
+#endif
+        _resize_file(data_offset + sizeof(T) * new_capaity);
+        fc_memory_stats(file_mapped_memory, _reallocate(sizeof(T) * new_capaity, sizeof(T) * capacity_, sizeof(T) * new_capaity, data_ != old_data));
+        capacity_ = new_capaity;
+    }
+
+    void _swap(file_mapped_memory& r) noexcept
+    {
+        std::swap(capacity_, r.capacity_);
+        std::swap(size_, r.size_);
+        std::swap(data_, r.data_);
+        file_.swap(r.file_);
+    }
+
+    void _resize_file(size_t size)
+    {
+        if (!file_.resize(size)) {
+            throw std::bad_alloc();
+        }
+        data_ = (T*)(file_.data() + data_offset);
+    }
+
+    file_mapped_header* _header() const { return (file_mapped_header*)file_.data(); }
+
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    T* data_ = nullptr;
+    mapped_file file_;
+};
+
+
+template<class T>
+using file_vector = basic_vector<T, file_mapped_memory<T>>;
+
+template<class T>
+using file_raw_vector = basic_raw_vector<T, file_mapped_memory<T>>;
+
+template <class Key, class Value, class Compare = std::less<>>
+using file_map = basic_map<Key, Value, Compare, file_vector<std::pair<Key, Value>>>;
+
+template <class Key, class Compare = std::less<>>
+using file_set = basic_set<Key, Compare, file_vector<Key>>;
+
+} // namespace ist
@@ -0,0 +1,296 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <exception>
+#include <system_error>
+#include <new>
+#include <type_traits>
+
+// parallel stable sort & merge for bulk construction of flat containers.
+// chunks are sorted by std::stable_sort on each thread, then merged pairwise. each merge is split into
+// independent parts by binary search on the merge path, so all threads work on every level.
+// results of stable sort & merge are identical to std::stable_sort / std::inplace_merge. (equal elements keep their order)
+// std::execution::par is not used because libstdc++ requires TBB for it.
+
+namespace ist {
+
+// ranges smaller than this per thread are sorted single threaded.
+inline constexpr size_t parallel_sort_min_chunk = 32768;
+
+inline std::atomic<size_t>& _parallel_threads()
+{
+    static std::atomic<size_t> s_threads{ 0 };
+    return s_threads;
+}
+
+// number of threads used by flat_map / flat_set to sort and merge large ranges.
+// 0 (default) is std::thread::hardware_concurrency(). 1 disables parallel sort.
+inline void set_parallel_threads(size_t n) { _parallel_threads() = n; }
+
+inline size_t get_parallel_threads()
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    size_t n = _parallel_threads();
+    return n != 0 ? n : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#endif
+}
+
+// run f(i) for i in [0, num_tasks) on up to num_threads threads. the calling thread takes part.
+// if threads can't be created, the calling thread runs the rest of the tasks.
+// the first exception thrown by f is rethrown after all threads finish.
+template<class F>
+inline void _parallel_for(size_t num_tasks, size_t num_threads, F&& f)
+{
+    num_threads = std::min(num_threads, num_tasks);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < num_tasks; ++i) {
+            f(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+    auto worker = [&]() {
+        for (size_t i; !failed && (i = next++) < num_tasks; ) {
+            try {
+                f(i);
+            }
+            catch (...) {
+                if (!failed.exchange(true)) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(num_threads - 1);
+        for (size_t i = 1; i < num_threads; ++i) {
+            threads.emplace_back(worker);
+        }
+    }
+    catch (const std::system_error&) {
+        // no more threads. the threads already started and the calling thread take the tasks.
+    }
+    catch (const std::bad_alloc&) {
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// number of elements taken from a in the first k elements of the stable merge of a and b. (merge path)
+template<class IterA, class IterB, class Compare>
+inline size_t _merge_split(IterA a, size_t na, IterB b, size_t nb, size_t k, Compare& cmp)
+{
+    size_t lo = k > nb ? k - nb : 0;
+    size_t hi = std::min(k, na);
+    while (lo < hi) {
+        size_t i = (lo + hi) / 2;
+        // a[i] precedes b[k - i - 1] unless b's is strictly less
+        if (!cmp(b[k - i - 1], a[i])) {
+            lo = i + 1;
+        }
+        else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+// a run is a sorted range [begin, end) in the source buffer.
+struct _merge_task
+{
+    size_t a, na, b, nb; // two runs to merge. nb is 0 for a single run
+    size_t out_begin, out_end; // part of the output [a, b + nb)
+};
+
+// tasks of each level of the pairwise merge of sorted runs (given by boundaries) until one remains.
+// all allocations are done here, so a failure leaves the data untouched.
+inline std::vector<std::vector<_merge_task>> _plan_merge(std::vector<size_t> bounds, size_t num_threads)
+{
+    std::vector<std::vector<_merge_task>> levels;
+    while (bounds.size() > 2) {
+        size_t num_runs = bounds.size() - 1;
+        size_t num_pairs = (num_runs + 1) / 2;
+        size_t parts_per_pair = std::max<size_t>(num_threads / num_pairs, 1);
+
+        auto& tasks = levels.emplace_back();
+        std::vector<size_t> next_bounds;
+        for (size_t r = 0; r < num_runs; r += 2) {
+            size_t a = bounds[r];
+            size_t b = bounds[r + 1];
+            size_t e = r + 2 < bounds.size() ? bounds[r + 2] : b;
+            next_bounds.push_back(a);
+            size_t n = e - a;
+            size_t parts = std::min(parts_per_pair, std::max<size_t>(n / parallel_sort_min_chunk, 1));
+            for (size_t p = 0; p < parts; ++p) {
+                tasks.push_back({ a, b - a, b, e - b, a + n * p / parts, a + n * (p + 1) / parts });
+            }
+        }
+        next_bounds.push_back(bounds.back());
+        bounds.swap(next_bounds);
+    }
+    return levels;
+}
+
+// run the merge planned by _plan_merge(). src & tmp must be the same size.
+// returns true if the result is in tmp.
+template<class T, class Compare>
+inline bool _parallel_merge_runs(T* src, T* tmp, const std::vector<std::vector<_merge_task>>& levels, Compare& cmp, size_t num_threads)
+{
+    bool in_tmp = false;
+    for (auto& tasks : levels) {
+        T* dst = in_tmp ? src : tmp;
+        T* from = in_tmp ? tmp : src;
+        // std::merge passes the elements of move iterators as rvalues.
+        auto less = [&](const T& x, const T& y) { return cmp(x, y); };
+        _parallel_for(tasks.size(), num_threads, [&](size_t ti) {
+            auto& t = tasks[ti];
+            T* a = from + t.a;
+            T* b = from + t.b;
+            size_t k0 = t.out_begin - t.a;
+            size_t k1 = t.out_end - t.a;
+            size_t i0 = _merge_split(a, t.na, b, t.nb, k0, cmp);
+            size_t i1 = _merge_split(a, t.na, b, t.nb, k1, cmp);
+            std::merge(std::make_move_iterator(a + i0), std::make_move_iterator(a + i1),
+                std::make_move_iterator(b + (k0 - i0)), std::make_move_iterator(b + (k1 - i1)),
+                dst + t.out_begin, less);
+        });
+        in_tmp = !in_tmp;
+    }
+    return in_tmp;
+}
+
+template<class T>
+inline void _parallel_move(T* src, T* dst, size_t n, size_t num_threads)
+{
+    size_t parts = std::min(num_threads, std::max<size_t>(n / parallel_sort_min_chunk, 1));
+    _parallel_for(parts, num_threads, [&](size_t p) {
+        std::move(src + n * p / parts, src + n * (p + 1) / parts, dst + n * p / parts);
+    });
+}
+
+// the range is accessed through T* of the first element, so it must be contiguous. (not just random access)
+template<class Iter>
+constexpr bool _is_contiguous_iterator_v =
+#if __cpp_lib_concepts
+    std::contiguous_iterator<Iter>;
+#else
+    std::is_pointer_v<Iter> ||
+    std::is_same_v<Iter, typename std::vector<typename std::iterator_traits<Iter>::value_type>::iterator> ||
+    std::is_same_v<Iter, typename std::vector<typename std::iterator_traits<Iter>::value_type>::const_iterator>;
+#endif
+
+template<class Iter>
+constexpr bool _is_parallel_sortable_v =
+    _is_contiguous_iterator_v<Iter> &&
+    std::is_default_constructible_v<typename std::iterator_traits<Iter>::value_type> &&
+    std::is_move_assignable_v<typename std::iterator_traits<Iter>::value_type>;
+
+template<bool Stable, class Iter, class Compare>
+inline void _parallel_sort_impl(Iter first, Iter last, Compare& cmp)
+{
+    using T = typename std::iterator_traits<Iter>::value_type;
+    size_t n = std::distance(first, last);
+    size_t num_threads = std::min(get_parallel_threads(), n / parallel_sort_min_chunk);
+    if constexpr (_is_parallel_sortable_v<Iter>) {
+        // allocate everything before touching the data. on failure, fall back to the single threaded path.
+        std::vector<size_t> bounds;
+        std::vector<std::vector<_merge_task>> levels;
+        std::vector<T> tmp;
+        if (num_threads > 1) {
+            try {
+                for (size_t i = 0; i <= num_threads; ++i) {
+                    bounds.push_back(n * i / num_threads);
+                }
+                levels = _plan_merge(bounds, num_threads);
+                tmp.resize(n);
+            }
+            catch (const std::bad_alloc&) {
+                num_threads = 1;
+            }
+        }
+        if (num_threads > 1) {
+            T* data = &*first;
+            _parallel_for(num_threads, num_threads, [&](size_t i) {
+                if constexpr (Stable) {
+                    std::stable_sort(data + bounds[i], data + bounds[i + 1], cmp);
+                }
+                else {
+                    std::sort(data + bounds[i], data + bounds[i + 1], cmp);
+                }
+            });
+
+            if (_parallel_merge_runs(data, tmp.data(), levels, cmp, num_threads)) {
+                _parallel_move(tmp.data(), data, n, num_threads);
+            }
+            return;
+        }
+    }
+    if constexpr (Stable) {
+        std::stable_sort(first, last, cmp);
+    }
+    else {
+        std::sort(first, last, cmp);
+    }
+}
+
+// same result as std::sort(). non-contiguous ranges are processed single threaded.
+template<class Iter, class Compare>
+inline void _parallel_sort(Iter first, Iter last, Compare cmp)
+{
+    _parallel_sort_impl<false>(first, last, cmp);
+}
+
+// same result as std::stable_sort(). non-contiguous ranges are processed single threaded.
+template<class Iter, class Compare>
+inline void _parallel_stable_sort(Iter first, Iter last, Compare cmp)
+{
+    _parallel_sort_impl<true>(first, last, cmp);
+}
+
+// same result as std::inplace_merge(). non-contiguous ranges are processed single threaded.
+template<class Iter, class Compare>
+inline void _parallel_inplace_merge(Iter first, Iter mid, Iter last, Compare cmp)
+{
+    using T = typename std::iterator_traits<Iter>::value_type;
+    size_t n = std::distance(first, last);
+    size_t num_threads = std::min(get_parallel_threads(), n / parallel_sort_min_chunk);
+    if constexpr (_is_parallel_sortable_v<Iter>) {
+        std::vector<std::vector<_merge_task>> levels;
+        std::vector<T> tmp;
+        if (num_threads > 1) {
+            try {
+                levels = _plan_merge({ 0, size_t(std::distance(first, mid)), n }, num_threads);
+                tmp.resize(n);
+            }
+            catch (const std::bad_alloc&) {
+                num_threads = 1;
+            }
+        }
+        if (num_threads > 1) {
+            T* data = &*first;
+            if (_parallel_merge_runs(data, tmp.data(), levels, cmp, num_threads)) {
+                _parallel_move(tmp.data(), data, n, num_threads);
+            }
+            return;
+        }
+    }
+    std::inplace_merge(first, mid, last, cmp);
+}
+
+} // namespace ist
@@ -43,6 +43,12 @@ public:
     {
     }
 
+    template<bool file = is_file_mapped_memory_v<super>, fc_require(file)>
+    explicit basic_raw_vector(const char* path, file_open_mode mode = file_open_mode::open_or_create)
+        : super(path, mode)
+    {
+    }
+
     using super::capacity;
     using super::size;
     using super::size_bytes;
@@ -191,6 +197,9 @@ using sbo_raw_vector = basic_raw_vector<T, sbo_memory<T, Capacity>>;
 template<class T>
 using mapped_raw_vector = basic_raw_vector<T, mapped_memory<T>>;
 
+template<class T>
+using arena_raw_vector = basic_raw_vector<T, arena_memory<T>>;
+
 } // namespace ist
 
 
@@ -0,0 +1,296 @@
+#pragma once
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <stdexcept>
+#include "flat_set.h"
+#include "flat_map.h"
+#include "simd.h"
+
+// set algebra on flat sets, and key-wise on flat maps. (values of maps are taken from a, or from whichever has the key)
+// results are written directly into the destination's container, which is reused if it has capacity.
+// all operations are linear in the sizes. when one side is much smaller, the larger side is searched by
+// galloping (exponential search), so the cost is O(small * log(large / small)) plus the output.
+// intersection of sets of 32/64 bit integers with std::less uses a SIMD kernel. (see _intersect_sorted_simd)
+//
+// auto c = ist::set_intersection(a, b);
+// ist::set_union(a, b, c); // into existing c. c may be a or b.
+// mapped and file backed sets can only be the destination of the form above. (they can't grow into a new buffer)
+
+namespace ist {
+
+// the larger side is galloped when it is at least this times larger than the other.
+constexpr size_t set_gallop_ratio = 32;
+
+template<class Container, class Iter>
+inline void _append_range(Container& dst, Iter first, Iter last)
+{
+    dst.insert(dst.end(), first, last);
+}
+
+enum class _set_op
+{
+    union_,
+    intersection,
+    difference,
+    symmetric_difference,
+};
+
+// less compares elements. for maps, it compares keys of the pairs.
+template<_set_op Op, class Iter, class Less, class Container>
+inline void _set_operation(Iter a, Iter ae, Iter b, Iter be, Less less, Container& dst)
+{
+    size_t na = std::distance(a, ae);
+    size_t nb = std::distance(b, be);
+
+    if constexpr (Op == _set_op::intersection) {
+        dst.reserve(std::min(na, nb));
+        if (na * set_gallop_ratio <= nb || nb * set_gallop_ratio <= na) {
+            // iterate the smaller one. elements are taken from a.
+            if (na <= nb) {
+                for (; a != ae && b != be; ++a) {
+                    b = _gallop_lower_bound(b, be, *a, less);
+                    if (b != be && !less(*a, *b)) {
+                        dst.push_back(*a);
+                        ++b;
+                    }
+                }
+            }
+            else {
+                for (; a != ae && b != be; ++b) {
+                    a = _gallop_lower_bound(a, ae, *b, less);
+                    if (a != ae && !less(*b, *a)) {
+                        dst.push_back(*a);
+                        ++a;
+                    }
+                }
+            }
+            return;
+        }
+        while (a != ae && b != be) {
+            if (less(*a, *b)) {
+                ++a;
+            }
+            else if (less(*b, *a)) {
+                ++b;
+            }
+            else {
+                dst.push_back(*a);
+                ++a;
+                ++b;
+            }
+        }
+    }
+    else if constexpr (Op == _set_op::difference) {
+        dst.reserve(na);
+        if (na * set_gallop_ratio <= nb) {
+            // few elements in a. look each up in b.
+            for (; a != ae; ++a) {
+                b = _gallop_lower_bound(b, be, *a, less);
+                if (b == be || less(*a, *b)) {
+                    dst.push_back(*a);
+                }
+            }
+            return;
+        }
+        if (nb * set_gallop_ratio <= na) {
+            // few elements in b. copy runs of a between them at once.
+            for (; b != be && a != ae; ++b) {
+                Iter run_end = _gallop_lower_bound(a, ae, *b, less);
+                _append_range(dst, a, run_end);
+                a = run_end;
+                if (a != ae && !less(*b, *a)) {
+                    ++a;
+                }
+            }
+            _append_range(dst, a, ae);
+            return;
+        }
+        while (a != ae && b != be) {
+            if (less(*a, *b)) {
+                dst.push_back(*a);
+                ++a;
+            }
+            else {
+                if (!less(*b, *a)) {
+                    ++a;
+                }
+                ++b;
+            }
+        }
+        _append_range(dst, a, ae);
+    }
+    else {
+        // union & symmetric difference
+        dst.reserve(na + nb);
+        if (na * set_gallop_ratio <= nb || nb * set_gallop_ratio <= na) {
+            // copy runs of the larger side between elements of the smaller side at once.
+            while (a != ae && b != be) {
+                if (less(*a, *b)) {
+                    Iter e = _gallop_lower_bound(a, ae, *b, less);
+                    _append_range(dst, a, e);
+                    a = e;
+                }
+                else if (less(*b, *a)) {
+                    Iter e = _gallop_lower_bound(b, be, *a, less);
+                    _append_range(dst, b, e);
+                    b = e;
+                }
+                else {
+                    if constexpr (Op == _set_op::union_) {
+                        dst.push_back(*a);
+                    }
+                    ++a;
+                    ++b;
+                }
+            }
+        }
+        else {
+            while (a != ae && b != be) {
+                if (less(*a, *b)) {
+                    dst.push_back(*a);
+                    ++a;
+                }
+                else if (less(*b, *a)) {
+                    dst.push_back(*b);
+                    ++b;
+                }
+                else {
+                    if constexpr (Op == _set_op::union_) {
+                        dst.push_back(*a);
+                    }
+                    ++a;
+                    ++b;
+                }
+            }
+        }
+        _append_range(dst, a, ae);
+        _append_range(dst, b, be);
+    }
+}
+
+// mapped and file backed containers have no storage of their own when default constructed.
+// when dst is a or b, the result is built in a temporary and copied back into the storage of dst.
+template<_set_op Op, class Set, class Less>
+inline bool _set_operation_aliased(const Set& a, const Set& b, Set& dst, Less less)
+{
+    using container_type = typename Set::container_type;
+    if constexpr (is_mapped_memory_v<container_type> || is_file_mapped_memory_v<container_type>) {
+        if (&dst == &a || &dst == &b) {
+            std::vector<typename container_type::value_type> tmp;
+            _set_operation<Op>(a.begin(), a.end(), b.begin(), b.end(), less, tmp);
+
+            container_type r;
+            r = dst.extract();
+            if constexpr (is_mapped_memory_v<container_type>) {
+                if (tmp.size() > r.capacity()) {
+                    dst.adopt(std::move(r));
+                    throw std::out_of_range("out of capacity");
+                }
+            }
+            r.clear();
+            r.insert(r.end(), tmp.begin(), tmp.end());
+            dst.adopt(std::move(r));
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class Set>
+constexpr bool _is_growable_set_v = !is_mapped_memory_v<typename Set::container_type> && !is_file_mapped_memory_v<typename Set::container_type>;
+
+template<_set_op Op, class Key, class Compare, class Container>
+inline void _set_operation(const basic_set<Key, Compare, Container>& a, const basic_set<Key, Compare, Container>& b, basic_set<Key, Compare, Container>& dst)
+{
+    if (_set_operation_aliased<Op>(a, b, dst, Compare())) {
+        return;
+    }
+    // reuse the buffer of dst unless it is a or b.
+    Container r;
+    if (&dst != &a && &dst != &b) {
+        r = dst.extract();
+        r.clear();
+    }
+
+    if constexpr (Op == _set_op::intersection && has_intersect_sorted_simd_v<Key> && is_linear_searchable_v<Key, Compare>) {
+        size_t na = a.size(), nb = b.size();
+        if (na * set_gallop_ratio > nb && nb * set_gallop_ratio > na) {
+            const Key* s = na <= nb ? a.data() : b.data();
+            const Key* l = na <= nb ? b.data() : a.data();
+            r.resize(std::min(na, nb));
+            r.resize(_intersect_sorted_simd(s, std::min(na, nb), l, std::max(na, nb), r.data()));
+            dst.adopt(std::move(r));
+            return;
+        }
+    }
+    _set_operation<Op>(a.begin(), a.end(), b.begin(), b.end(), Compare(), r);
+    dst.adopt(std::move(r));
+}
+
+template<_set_op Op, class Key, class Value, class Compare, class Container>
+inline void _set_operation(const basic_map<Key, Value, Compare, Container>& a, const basic_map<Key, Value, Compare, Container>& b, basic_map<Key, Value, Compare, Container>& dst)
+{
+    auto less = [](auto& x, auto& y) { return Compare()(x.first, y.first); };
+    if (_set_operation_aliased<Op>(a, b, dst, less)) {
+        return;
+    }
+    Container r;
+    if (&dst != &a && &dst != &b) {
+        r = dst.extract();
+        r.clear();
+    }
+    _set_operation<Op>(a.begin(), a.end(), b.begin(), b.end(), less, r);
+    dst.adopt(std::move(r));
+}
+
+
+// elements in a or b. for maps, a's value is taken if both have the key.
+template<class Set>
+inline void set_union(const Set& a, const Set& b, Set& dst) { _set_operation<_set_op::union_>(a, b, dst); }
+template<class Set>
+inline Set set_union(const Set& a, const Set& b)
+{
+    static_assert(_is_growable_set_v<Set>, "mapped and file backed sets can't be returned. pass the destination instead.");
+    Set r;
+    set_union(a, b, r);
+    return r;
+}
+
+// elements in both a and b. for maps, values are taken from a.
+template<class Set>
+inline void set_intersection(const Set& a, const Set& b, Set& dst) { _set_operation<_set_op::intersection>(a, b, dst); }
+template<class Set>
+inline Set set_intersection(const Set& a, const Set& b)
+{
+    static_assert(_is_growable_set_v<Set>, "mapped and file backed sets can't be returned. pass the destination instead.");
+    Set r;
+    set_intersection(a, b, r);
+    return r;
+}
+
+// elements in a but not in b.
+template<class Set>
+inline void set_difference(const Set& a, const Set& b, Set& dst) { _set_operation<_set_op::difference>(a, b, dst); }
+template<class Set>
+inline Set set_difference(const Set& a, const Set& b)
+{
+    static_assert(_is_growable_set_v<Set>, "mapped and file backed sets can't be returned. pass the destination instead.");
+    Set r;
+    set_difference(a, b, r);
+    return r;
+}
+
+// elements in either a or b, but not in both.
+template<class Set>
+inline void set_symmetric_difference(const Set& a, const Set& b, Set& dst) { _set_operation<_set_op::symmetric_difference>(a, b, dst); }
+template<class Set>
+inline Set set_symmetric_difference(const Set& a, const Set& b)
+{
+    static_assert(_is_growable_set_v<Set>, "mapped and file backed sets can't be returned. pass the destination instead.");
+    Set r;
+    set_symmetric_difference(a, b, r);
+    return r;
+}
+
+} // namespace ist
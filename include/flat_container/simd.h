@@ -0,0 +1,359 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <functional>
+#include "memory.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#   define fc_x86
+#   include <immintrin.h>
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define fc_sse2
+#   endif
+#   if defined(__SSE4_2__) || defined(__AVX__)
+#       define fc_sse42
+#   endif
+#   if defined(__AVX2__)
+#       define fc_avx2
+#   endif
+#endif
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+namespace ist {
+
+inline int _popcount(uint32_t v)
+{
+#if defined(__GNUC__)
+    return __builtin_popcount(v);
+#elif defined(_MSC_VER)
+    return (int)__popcnt(v);
+#else
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    return (int)((((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+#endif
+}
+
+inline int _ctz(uint32_t v)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(v);
+#elif defined(_MSC_VER)
+    unsigned long r;
+    _BitScanForward(&r, v);
+    return (int)r;
+#else
+    int r = 0;
+    while ((v & 1) == 0) {
+        v >>= 1;
+        ++r;
+    }
+    return r;
+#endif
+}
+
+// index of the highest set bit. v must not be 0.
+inline int _bsr(uint32_t v)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(v);
+#elif defined(_MSC_VER)
+    unsigned long r;
+    _BitScanReverse(&r, v);
+    return (int)r;
+#else
+    int r = 0;
+    while (v >>= 1) {
+        ++r;
+    }
+    return r;
+#endif
+}
+
+
+// linear search on small sorted arrays.
+// binary search on small arrays is dominated by branch misprediction. comparing all keys with SIMD is faster.
+
+// sorted arrays of these key types with these comparators can be searched by _linear_lower_bound()
+template<class Key, class Compare>
+constexpr bool is_linear_searchable_v = std::is_arithmetic_v<Key> && !std::is_same_v<Key, bool> &&
+    (std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<Key>>);
+
+// arrays up to this size use linear search. (see bench_linear_search in test)
+#ifndef FC_LINEAR_SEARCH_THRESHOLD
+#   define FC_LINEAR_SEARCH_THRESHOLD 64
+#endif
+constexpr size_t linear_search_threshold = FC_LINEAR_SEARCH_THRESHOLD;
+
+template<class T>
+inline size_t _linear_lower_bound_scalar(const T* keys, size_t i, size_t n, T v)
+{
+    // branchless. keys are sorted so count of smaller ones is the position.
+    size_t r = i;
+    for (; i < n; ++i) {
+        r += keys[i] < v ? 1 : 0;
+    }
+    return r;
+}
+
+#if defined(fc_sse2)
+
+// count all keys < v without early exit. early exit causes branch misprediction, which is what we want to avoid.
+// comparison results are -1 (all bits set) or 0, so subtracting them from the accumulator counts up.
+
+inline size_t _hsum_epi32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(v);
+}
+inline size_t _hsum_epi64(__m128i v)
+{
+    v = _mm_add_epi64(v, _mm_unpackhi_epi64(v, v));
+#if defined(_M_X64) || defined(__x86_64__)
+    return (size_t)_mm_cvtsi128_si64(v);
+#else
+    return (uint32_t)_mm_cvtsi128_si32(v);
+#endif
+}
+#if defined(fc_avx2)
+inline size_t _hsum_epi32(__m256i v)
+{
+    return _hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+inline size_t _hsum_epi64(__m256i v)
+{
+    return _hsum_epi64(_mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+#endif
+
+template<class T, fc_require(std::is_integral_v<T> && sizeof(T) == 4)>
+inline size_t _linear_lower_bound_simd(const T* keys, size_t n, T v)
+{
+    // SSE2/AVX2 only have signed comparison. flip the sign bit to compare unsigned.
+    constexpr uint32_t bias = std::is_signed_v<T> ? 0 : 0x80000000u;
+    size_t i = 0, r = 0;
+#if defined(fc_avx2)
+    {
+        const __m256i b8 = _mm256_set1_epi32((int)bias);
+        const __m256i v8 = _mm256_xor_si256(_mm256_set1_epi32((int)v), b8);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 8 <= n; i += 8) {
+            __m256i k = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), b8);
+            acc = _mm256_sub_epi32(acc, _mm256_cmpgt_epi32(v8, k));
+        }
+        r += _hsum_epi32(acc);
+    }
+#endif
+    {
+        const __m128i b4 = _mm_set1_epi32((int)bias);
+        const __m128i v4 = _mm_xor_si128(_mm_set1_epi32((int)v), b4);
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 4 <= n; i += 4) {
+            __m128i k = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), b4);
+            acc = _mm_sub_epi32(acc, _mm_cmplt_epi32(k, v4));
+        }
+        r += _hsum_epi32(acc);
+    }
+    return _linear_lower_bound_scalar(keys, i, n, v) - i + r;
+}
+
+template<class T, fc_require(std::is_integral_v<T> && sizeof(T) == 8)>
+inline size_t _linear_lower_bound_simd(const T* keys, size_t n, T v)
+{
+    size_t i = 0, r = 0;
+#if defined(fc_avx2)
+    {
+        constexpr uint64_t bias = std::is_signed_v<T> ? 0 : 0x8000000000000000ull;
+        const __m256i b4 = _mm256_set1_epi64x((long long)bias);
+        const __m256i v4 = _mm256_xor_si256(_mm256_set1_epi64x((long long)v), b4);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 4 <= n; i += 4) {
+            __m256i k = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), b4);
+            acc = _mm256_sub_epi64(acc, _mm256_cmpgt_epi64(v4, k));
+        }
+        r += _hsum_epi64(acc);
+    }
+#endif
+    // no 64 bit integer comparison in SSE2. leave the rest to scalar (compilers vectorize it well enough).
+    return _linear_lower_bound_scalar(keys, i, n, v) - i + r;
+}
+
+inline size_t _linear_lower_bound_simd(const float* keys, size_t n, float v)
+{
+    size_t i = 0, r = 0;
+#if defined(fc_avx2)
+    {
+        const __m256 v8 = _mm256_set1_ps(v);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 8 <= n; i += 8) {
+            __m256 lt = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), v8, _CMP_LT_OQ);
+            acc = _mm256_sub_epi32(acc, _mm256_castps_si256(lt));
+        }
+        r += _hsum_epi32(acc);
+    }
+#endif
+    {
+        const __m128 v4 = _mm_set1_ps(v);
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 4 <= n; i += 4) {
+            __m128 lt = _mm_cmplt_ps(_mm_loadu_ps(keys + i), v4);
+            acc = _mm_sub_epi32(acc, _mm_castps_si128(lt));
+        }
+        r += _hsum_epi32(acc);
+    }
+    return _linear_lower_bound_scalar(keys, i, n, v) - i + r;
+}
+
+inline size_t _linear_lower_bound_simd(const double* keys, size_t n, double v)
+{
+    size_t i = 0, r = 0;
+#if defined(fc_avx2)
+    {
+        const __m256d v4 = _mm256_set1_pd(v);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 4 <= n; i += 4) {
+            __m256d lt = _mm256_cmp_pd(_mm256_loadu_pd(keys + i), v4, _CMP_LT_OQ);
+            acc = _mm256_sub_epi64(acc, _mm256_castpd_si256(lt));
+        }
+        r += _hsum_epi64(acc);
+    }
+#endif
+    {
+        const __m128d v2 = _mm_set1_pd(v);
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 2 <= n; i += 2) {
+            __m128d lt = _mm_cmplt_pd(_mm_loadu_pd(keys + i), v2);
+            acc = _mm_sub_epi64(acc, _mm_castpd_si128(lt));
+        }
+        r += _hsum_epi64(acc);
+    }
+    return _linear_lower_bound_scalar(keys, i, n, v) - i + r;
+}
+
+#endif // fc_sse2
+
+template<class T, class = void>
+constexpr bool has_linear_lower_bound_simd_v = false;
+template<class T>
+constexpr bool has_linear_lower_bound_simd_v<T, std::void_t<decltype(_linear_lower_bound_simd(std::declval<const T*>(), size_t(), std::declval<T>()))>> = true;
+
+// returns position of the first key that is not less than v. keys must be sorted.
+template<class T>
+inline size_t _linear_lower_bound(const T* keys, size_t n, T v)
+{
+    if constexpr (has_linear_lower_bound_simd_v<T>) {
+        return _linear_lower_bound_simd(keys, n, v);
+    }
+    else {
+        return _linear_lower_bound_scalar(keys, 0, n, v);
+    }
+}
+
+
+
+// intersection of sorted unique integer arrays.
+// each element of a is compared with a cache line of b at once, and b is skipped by cache lines.
+// O(na + nb / block) comparisons without data dependent branches in the compare, so a should be the smaller one.
+// returns the number of elements written to out. out may be a.
+
+#if defined(fc_sse2)
+
+template<class T>
+constexpr size_t _intersect_block = 64 / sizeof(T);
+
+template<class T, fc_require(std::is_integral_v<T> && sizeof(T) == 4)>
+inline bool _block_contains(const T* p, T x)
+{
+#if defined(fc_avx2)
+    const __m256i v = _mm256_set1_epi32((int)x);
+    __m256i c = _mm256_or_si256(
+        _mm256_cmpeq_epi32(v, _mm256_loadu_si256((const __m256i*)p)),
+        _mm256_cmpeq_epi32(v, _mm256_loadu_si256((const __m256i*)(p + 8))));
+    return !_mm256_testz_si256(c, c);
+#else
+    const __m128i v = _mm_set1_epi32((int)x);
+    __m128i c = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)p)), _mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)(p + 4)))),
+        _mm_or_si128(_mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)(p + 8))), _mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)(p + 12)))));
+    return _mm_movemask_epi8(c) != 0;
+#endif
+}
+
+template<class T, fc_require(std::is_integral_v<T> && sizeof(T) == 8)>
+inline bool _block_contains(const T* p, T x)
+{
+#if defined(fc_avx2)
+    const __m256i v = _mm256_set1_epi64x((long long)x);
+    __m256i c = _mm256_or_si256(
+        _mm256_cmpeq_epi64(v, _mm256_loadu_si256((const __m256i*)p)),
+        _mm256_cmpeq_epi64(v, _mm256_loadu_si256((const __m256i*)(p + 4))));
+    return !_mm256_testz_si256(c, c);
+#else
+    // SSE2 has no 64 bit cmpeq. both 32 bit halves must match.
+    const __m128i v = _mm_set1_epi64x((long long)x);
+    __m128i c = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)p)), _mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)(p + 2)))),
+        _mm_or_si128(_mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)(p + 4))), _mm_cmpeq_epi32(v, _mm_loadu_si128((const __m128i*)(p + 6)))));
+    // or-ing blocks first may combine halves of different elements. recheck the candidates when it hits.
+    if (_mm_movemask_epi8(_mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)))) == 0) {
+        return false;
+    }
+    for (int i = 0; i < 8; ++i) {
+        if (p[i] == x) {
+            return true;
+        }
+    }
+    return false;
+#endif
+}
+
+template<class T, fc_require(std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8))>
+inline size_t _intersect_sorted_simd(const T* a, size_t na, const T* b, size_t nb, T* out)
+{
+    constexpr size_t W = _intersect_block<T>;
+    size_t i = 0, j = 0, r = 0;
+    if (nb >= W) {
+        for (; i < na; ++i) {
+            T x = a[i];
+            // blocks that end before x can't contain it, nor any later element of a.
+            while (b[j + W - 1] < x) {
+                j += W;
+                if (j + W > nb) {
+                    break;
+                }
+            }
+            if (j + W > nb) {
+                break;
+            }
+            out[r] = x;
+            r += _block_contains(b + j, x) ? 1 : 0;
+        }
+    }
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            ++i;
+        }
+        else if (b[j] < a[i]) {
+            ++j;
+        }
+        else {
+            out[r++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return r;
+}
+
+#endif // fc_sse2
+
+template<class T, class = void>
+constexpr bool has_intersect_sorted_simd_v = false;
+template<class T>
+constexpr bool has_intersect_sorted_simd_v<T, std::void_t<decltype(_intersect_sorted_simd(std::declval<const T*>(), size_t(), std::declval<const T*>(), size_t(), std::declval<T*>()))>> = true;
+
+} // namespace ist
@@ -0,0 +1,154 @@
+#pragma once
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include "flat_map.h"
+#include "flat_set.h"
+
+namespace ist {
+
+// zero-copy snapshot of basic_map / basic_set.
+// the sorted backing array is written as is, and load_snapshot() returns mapped_map / mapped_set that points
+// directly into the loaded buffer. no sorting or insertion on load.
+// elements must be trivially copyable and must not contain pointers.
+// the format is not portable across platforms with different endianness or layout of the element type.
+//
+// layout:
+//   snapshot_header (64 bytes)
+//   elements (count * elem_size bytes)
+
+struct snapshot_header
+{
+    static constexpr uint32_t magic_value = 0x53534346; // "FCSS"
+    static constexpr uint32_t current_version = 1;
+
+    uint32_t magic = magic_value;
+    uint32_t version = current_version;
+    uint32_t elem_size = 0;
+    uint32_t elem_align = 0;
+    uint64_t count = 0;
+    uint64_t checksum = 0; // of elements
+    uint8_t reserved[32]{};
+};
+static_assert(sizeof(snapshot_header) == 64);
+
+// not cryptographic. processes 4 independent 64 bit lanes to run at memory bandwidth.
+inline uint64_t _snapshot_checksum(const void* data, size_t size)
+{
+    constexpr uint64_t k1 = 0x9e3779b97f4a7c15ull;
+    constexpr uint64_t k2 = 0xc2b2ae3d27d4eb4full;
+    auto rotl = [](uint64_t v, int s) { return (v << s) | (v >> (64 - s)); };
+    auto round = [&](uint64_t h, uint64_t w) { return rotl(h ^ (w * k2), 31) * k1; };
+
+    const std::byte* src = (const std::byte*)data;
+    uint64_t h[4] = { k1, k2, ~k1, ~k2 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t w[4];
+        std::memcpy(w, src + i, 32);
+        h[0] = round(h[0], w[0]);
+        h[1] = round(h[1], w[1]);
+        h[2] = round(h[2], w[2]);
+        h[3] = round(h[3], w[3]);
+    }
+    uint64_t r = rotl(h[0], 1) + rotl(h[1], 7) + rotl(h[2], 12) + rotl(h[3], 18);
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, src + i, 8);
+        r = round(r, w);
+    }
+    if (i < size) {
+        uint64_t w = 0;
+        std::memcpy(&w, src + i, size - i);
+        r = round(r, w);
+    }
+    r ^= size;
+    r = (r ^ (r >> 33)) * k2;
+    return r ^ (r >> 29);
+}
+
+template<class Container>
+inline snapshot_header _make_snapshot_header(const Container& c)
+{
+    using element_type = typename Container::container_type::value_type;
+    static_assert(is_pointer_free_v<element_type>, "snapshot requires trivially copyable types without pointers");
+
+    auto& data = c.get();
+    snapshot_header ret;
+    ret.elem_size = sizeof(element_type);
+    ret.elem_align = alignof(element_type);
+    ret.count = data.size();
+    ret.checksum = _snapshot_checksum(data.data(), sizeof(element_type) * data.size());
+    return ret;
+}
+
+// bytes required to write snapshot of c
+template<class Container>
+inline size_t snapshot_size(const Container& c)
+{
+    using element_type = typename Container::container_type::value_type;
+    return sizeof(snapshot_header) + sizeof(element_type) * c.size();
+}
+
+// returns written size. 0 if dst_size is not enough.
+template<class Container>
+inline size_t write_snapshot(const Container& c, void* dst, size_t dst_size)
+{
+    size_t size = snapshot_size(c);
+    if (dst_size < size) {
+        return 0;
+    }
+    auto header = _make_snapshot_header(c);
+    auto& data = c.get();
+    std::memcpy(dst, &header, sizeof(header));
+    std::memcpy((std::byte*)dst + sizeof(header), (const void*)data.data(), size - sizeof(header));
+    return size;
+}
+
+template<class Container>
+inline bool write_snapshot(const Container& c, std::ostream& os)
+{
+    auto header = _make_snapshot_header(c);
+    auto& data = c.get();
+    os.write((const char*)&header, sizeof(header));
+    os.write((const char*)data.data(), snapshot_size(c) - sizeof(header));
+    return os.good();
+}
+
+// Mapped is mapped_map or mapped_set. the returned container points into data, so data must outlive it.
+// data must be aligned to alignment of the element type. throws std::invalid_argument if data is not a valid snapshot.
+// treat the returned container as read-only. its capacity is the same as its size, so inserting writes past the snapshot
+// (undefined behavior. it throws only when FC_ENABLE_CAPACITY_CHECK is defined). erase modifies data.
+template<class Mapped>
+inline Mapped load_snapshot(void* data, size_t size, bool verify_checksum = true)
+{
+    using element_type = typename Mapped::container_type::value_type;
+    static_assert(is_mapped_memory_v<typename Mapped::container_type>, "load_snapshot() returns mapped_map or mapped_set");
+
+    if (size < sizeof(snapshot_header)) {
+        throw std::invalid_argument("load_snapshot(): too small");
+    }
+    snapshot_header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != snapshot_header::magic_value || header.version != snapshot_header::current_version) {
+        throw std::invalid_argument("load_snapshot(): not a snapshot");
+    }
+    if (header.elem_size != sizeof(element_type) || header.elem_align != alignof(element_type)) {
+        throw std::invalid_argument("load_snapshot(): element type mismatch");
+    }
+    if (header.count > (size - sizeof(header)) / sizeof(element_type)) {
+        throw std::invalid_argument("load_snapshot(): truncated");
+    }
+
+    std::byte* elements = (std::byte*)data + sizeof(header);
+    if ((uintptr_t)elements % alignof(element_type) != 0) {
+        throw std::invalid_argument("load_snapshot(): misaligned");
+    }
+    size_t count = (size_t)header.count;
+    if (verify_checksum && _snapshot_checksum(elements, sizeof(element_type) * count) != header.checksum) {
+        throw std::invalid_argument("load_snapshot(): checksum mismatch");
+    }
+    return Mapped(elements, count, count);
+}
+
+} // namespace ist
@@ -0,0 +1,447 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <initializer_list>
+#include "vector.h"
+#include "simd.h"
+
+namespace ist {
+
+// iterator of split_map. points a key and a value in separate arrays.
+// dereference yields std::pair of references.
+template<class Key, class Value>
+class split_iterator
+{
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<Key, std::remove_const_t<Value>>;
+    using reference = std::pair<const Key&, Value&>;
+
+    struct pointer
+    {
+        reference ref;
+        reference* operator->() { return &ref; }
+    };
+
+    using ptrdiff_t = std::ptrdiff_t;
+
+    split_iterator() = default;
+    split_iterator(const Key* k, Value* v) : key_(k), value_(v) {}
+    // iterator -> const_iterator
+    template<class V, fc_require(std::is_same_v<const V, Value>)>
+    split_iterator(const split_iterator<Key, V>& r) : key_(r.key_ptr()), value_(r.value_ptr()) {}
+
+    const Key* key_ptr() const { return key_; }
+    Value* value_ptr() const { return value_; }
+    const Key& key() const { return *key_; }
+    Value& value() const { return *value_; }
+
+    reference operator*() const { return { *key_, *value_ }; }
+    pointer operator->() const { return { { *key_, *value_ } }; }
+    reference operator[](ptrdiff_t n) const { return { key_[n], value_[n] }; }
+    split_iterator& operator++() { ++key_; ++value_; return *this; }
+    split_iterator& operator--() { --key_; --value_; return *this; }
+    split_iterator operator++(int) { auto ret = *this; ++*this; return ret; }
+    split_iterator operator--(int) { auto ret = *this; --*this; return ret; }
+    split_iterator& operator+=(ptrdiff_t n) { key_ += n; value_ += n; return *this; }
+    split_iterator& operator-=(ptrdiff_t n) { key_ -= n; value_ -= n; return *this; }
+    split_iterator operator+(ptrdiff_t n) const { return { key_ + n, value_ + n }; }
+    split_iterator operator-(ptrdiff_t n) const { return { key_ - n, value_ - n }; }
+    difference_type operator-(const split_iterator& r) const { return key_ - r.key_; }
+    bool operator<(const split_iterator& r) const { return key_ < r.key_; }
+    bool operator>(const split_iterator& r) const { return key_ > r.key_; }
+    bool operator<=(const split_iterator& r) const { return key_ <= r.key_; }
+    bool operator>=(const split_iterator& r) const { return key_ >= r.key_; }
+    bool operator==(const split_iterator& r) const { return key_ == r.key_; }
+    bool operator!=(const split_iterator& r) const { return key_ != r.key_; }
+
+private:
+    const Key* key_ = nullptr;
+    Value* value_ = nullptr;
+};
+
+
+// flat map with structure-of-arrays storage.
+// keys and values are stored in separate containers, so search scans a dense key array only.
+// (basic_map stores std::pair<Key, Value> and search touches values too)
+template <
+    class Key,
+    class Value,
+    class Compare = std::less<>,
+    class KeyContainer = vector<Key>,
+    class ValueContainer = vector<Value>
+>
+class basic_split_map
+{
+public:
+    using key_type               = Key;
+    using mapped_type            = Value;
+    using value_type             = std::pair<const key_type, mapped_type>;
+    using size_type              = std::size_t;
+    using difference_type        = std::ptrdiff_t;
+    using key_compare            = Compare;
+    using key_container_type     = KeyContainer;
+    using value_container_type   = ValueContainer;
+    using iterator               = split_iterator<key_type, mapped_type>;
+    using const_iterator         = split_iterator<key_type, const mapped_type>;
+    using reference              = typename iterator::reference;
+    using const_reference        = typename const_iterator::reference;
+
+    basic_split_map() {}
+    basic_split_map(const basic_split_map& v) { operator=(v); }
+    basic_split_map(basic_split_map&& v) noexcept { operator=(std::move(v)); }
+
+    template <class Iter, bool mapped = is_mapped_memory_v<key_container_type>, fc_require(!mapped)>
+    basic_split_map(Iter first, Iter last)
+    {
+        insert(first, last);
+    }
+    template <bool mapped = is_mapped_memory_v<key_container_type>, fc_require(!mapped)>
+    basic_split_map(std::initializer_list<value_type> list)
+    {
+        insert(list);
+    }
+
+    // construct from sorted & unique keys and corresponding values without sorting.
+    basic_split_map(sorted_unique_t, key_container_type&& keys, value_container_type&& values)
+        : keys_(std::move(keys)), values_(std::move(values))
+    {
+        sorted_check();
+    }
+
+    template<bool mapped = is_mapped_memory_v<key_container_type>, fc_require(mapped)>
+    basic_split_map(void* keys, void* values, size_t capacity, size_t size = 0)
+        : keys_(keys, capacity, size), values_(values, capacity, size)
+    {
+    }
+
+    basic_split_map& operator=(const basic_split_map& v)
+    {
+        keys_ = v.keys_;
+        values_ = v.values_;
+        return *this;
+    }
+    basic_split_map& operator=(basic_split_map&& v) noexcept
+    {
+        swap(v);
+        return *this;
+    }
+
+    void swap(basic_split_map& v) noexcept
+    {
+        keys_.swap(v.keys_);
+        values_.swap(v.values_);
+    }
+
+    const key_container_type& keys() const { return keys_; }
+    const value_container_type& values() const { return values_; }
+
+    bool operator==(const basic_split_map& v) const noexcept { return keys_ == v.keys_ && values_ == v.values_; }
+    bool operator!=(const basic_split_map& v) const noexcept { return !(*this == v); }
+
+    void reserve(size_type v)
+    {
+        keys_.reserve(v);
+        values_.reserve(v);
+    }
+    void clear()
+    {
+        keys_.clear();
+        values_.clear();
+    }
+    void shrink_to_fit()
+    {
+        keys_.shrink_to_fit();
+        values_.shrink_to_fit();
+    }
+
+    size_type empty() const noexcept { return keys_.empty(); }
+    size_type size() const noexcept { return keys_.size(); }
+    iterator begin() noexcept { return { keys_.data(), values_.data() }; }
+    const_iterator begin() const noexcept { return { keys_.data(), values_.data() }; }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return begin() + size(); }
+    const_iterator end() const noexcept { return begin() + size(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    // search
+
+    iterator lower_bound(const key_type& v)
+    {
+        return begin() + lower_index<key_type, key_compare>(v);
+    }
+    const_iterator lower_bound(const key_type& v) const
+    {
+        return begin() + lower_index<key_type, key_compare>(v);
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    iterator lower_bound(const V& v)
+    {
+        return begin() + lower_index<V, C>(v);
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator lower_bound(const V& v) const
+    {
+        return begin() + lower_index<V, C>(v);
+    }
+
+    iterator upper_bound(const key_type& v)
+    {
+        return begin() + upper_index<key_type, key_compare>(v);
+    }
+    const_iterator upper_bound(const key_type& v) const
+    {
+        return begin() + upper_index<key_type, key_compare>(v);
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    iterator upper_bound(const V& v)
+    {
+        return begin() + upper_index<V, C>(v);
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator upper_bound(const V& v) const
+    {
+        return begin() + upper_index<V, C>(v);
+    }
+
+    std::pair<iterator, iterator> equal_range(const key_type& v)
+    {
+        auto it = find(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& v) const
+    {
+        auto it = find(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    std::pair<iterator, iterator> equal_range(const V& v)
+    {
+        auto it = find<V, C>(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const V& v) const
+    {
+        auto it = find<V, C>(v);
+        return { it, it == end() ? it : it + 1 };
+    }
+
+    iterator find(const key_type& v)
+    {
+        return begin() + find_index<key_type, key_compare>(v);
+    }
+    const_iterator find(const key_type& v) const
+    {
+        return begin() + find_index<key_type, key_compare>(v);
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    iterator find(const V& v)
+    {
+        return begin() + find_index<V, C>(v);
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    const_iterator find(const V& v) const
+    {
+        return begin() + find_index<V, C>(v);
+    }
+
+    size_t count(const key_type& v) const
+    {
+        return find(v) != end() ? 1 : 0;
+    }
+    template <class V, class C = Compare, class = typename C::is_transparent>
+    size_t count(const V& v) const
+    {
+        return find<V, C>(v) != end() ? 1 : 0;
+    }
+
+    // insert & erase
+
+    std::pair<iterator, bool> insert(const value_type& v)
+    {
+        return emplace_at(v.first, v.second);
+    }
+    std::pair<iterator, bool> insert(value_type&& v)
+    {
+        return emplace_at(v.first, std::move(v.second));
+    }
+    template<class Iter>
+    void insert(Iter first, Iter last)
+    {
+        // sort & dedup new elements, drop ones that already exist, then merge from the back.
+        // O(N log N + N log M + M) instead of O(N*M) of inserting one by one.
+        std::vector<std::pair<key_type, mapped_type>> tmp(first, last);
+        std::stable_sort(tmp.begin(), tmp.end(), [](auto& a, auto& b) { return key_compare()(a.first, b.first); });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto& a, auto& b) { return equal(a.first, b.first); }), tmp.end());
+        tmp.erase(std::remove_if(tmp.begin(), tmp.end(), [this](auto& a) { return find(a.first) != end(); }), tmp.end());
+        if (tmp.empty()) {
+            return;
+        }
+
+        size_t n1 = size();
+        size_t n2 = tmp.size();
+        keys_.resize(n1 + n2);
+        values_.resize(n1 + n2);
+        auto* keys = keys_.data();
+        auto* values = values_.data();
+        size_t i1 = n1, i2 = n2, dst = n1 + n2;
+        while (i2 > 0) {
+            --dst;
+            if (i1 > 0 && key_compare()(tmp[i2 - 1].first, keys[i1 - 1])) {
+                --i1;
+                keys[dst] = std::move(keys[i1]);
+                values[dst] = std::move(values[i1]);
+            }
+            else {
+                --i2;
+                keys[dst] = std::move(tmp[i2].first);
+                values[dst] = std::move(tmp[i2].second);
+            }
+        }
+    }
+    void insert(std::initializer_list<value_type> list)
+    {
+        insert(list.begin(), list.end());
+    }
+
+    template<class... Args>
+    std::pair<iterator, bool> emplace(const key_type& key, Args&&... args)
+    {
+        return emplace_at(key, mapped_type(std::forward<Args>(args)...));
+    }
+
+    iterator erase(const key_type& v)
+    {
+        if (auto it = find(v); it != end()) {
+            return erase(it);
+        }
+        else {
+            return end();
+        }
+    }
+    iterator erase(const_iterator pos)
+    {
+        return erase(pos, pos + 1);
+    }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        size_t i1 = std::distance(cbegin(), first);
+        size_t i2 = std::distance(cbegin(), last);
+        keys_.erase(keys_.begin() + i1, keys_.begin() + i2);
+        values_.erase(values_.begin() + i1, values_.begin() + i2);
+        return begin() + i1;
+    }
+
+    mapped_type& at(const key_type& v)
+    {
+        if (auto it = find(v); it != end()) {
+            return it.value();
+        }
+        else {
+            throw std::out_of_range("split_map::at()");
+        }
+    }
+    const mapped_type& at(const key_type& v) const
+    {
+        if (auto it = find(v); it != end()) {
+            return it.value();
+        }
+        else {
+            throw std::out_of_range("split_map::at()");
+        }
+    }
+
+    mapped_type& operator[](const key_type& v)
+    {
+        return emplace_at(v, mapped_type{}).first.value();
+    }
+
+private:
+    template <class V, class C>
+    size_t lower_index(const V& v) const
+    {
+        if constexpr (std::is_same_v<V, key_type> && is_linear_searchable_v<key_type, C>) {
+            // keys are contiguous. small arithmetic keys can be searched by SIMD linear scan.
+            if (keys_.size() <= linear_search_threshold) {
+                return _linear_lower_bound(keys_.data(), keys_.size(), v);
+            }
+        }
+        return std::distance(keys_.begin(), std::lower_bound(keys_.begin(), keys_.end(), v, C()));
+    }
+    template <class V, class C>
+    size_t upper_index(const V& v) const
+    {
+        return std::distance(keys_.begin(), std::upper_bound(keys_.begin(), keys_.end(), v, C()));
+    }
+    template <class V, class C>
+    size_t find_index(const V& v) const
+    {
+        size_t i = lower_index<V, C>(v);
+        return (i != size() && !C()(v, keys_[i])) ? i : size();
+    }
+
+    template<class V>
+    std::pair<iterator, bool> emplace_at(const key_type& key, V&& value)
+    {
+        size_t i = lower_index<key_type, key_compare>(key);
+        if (i == size() || !equal(keys_[i], key)) {
+            keys_.insert(keys_.begin() + i, key);
+            values_.insert(values_.begin() + i, std::forward<V>(value));
+            return { begin() + i, true };
+        }
+        else {
+            return { begin() + i, false };
+        }
+    }
+
+    void sorted_check() const
+    {
+#ifdef FC_ENABLE_SORTED_CHECK
+        if (keys_.size() != values_.size()) {
+            throw std::invalid_argument("size of keys and values mismatch");
+        }
+        auto it = std::adjacent_find(keys_.begin(), keys_.end(), [](auto& a, auto& b) { return !key_compare()(a, b); });
+        if (it != keys_.end()) {
+            throw std::invalid_argument("not sorted or not unique");
+        }
+#endif
+    }
+
+    static bool equal(const key_type& a, const key_type& b)
+    {
+        return !Compare()(a, b) && !Compare()(b, a);
+    }
+
+private:
+    key_container_type keys_;
+    value_container_type values_;
+};
+
+
+template <class Key, class Value, class Compare = std::less<>>
+using split_map = basic_split_map<Key, Value, Compare, vector<Key>, vector<Value>>;
+
+template <class Key, class Value, size_t Capacity, class Compare = std::less<>>
+using fixed_split_map = basic_split_map<Key, Value, Compare, fixed_vector<Key, Capacity>, fixed_vector<Value, Capacity>>;
+
+template <class Key, class Value, size_t Capacity, class Compare = std::less<>>
+using sbo_split_map = basic_split_map<Key, Value, Compare, sbo_vector<Key, Capacity>, sbo_vector<Value, Capacity>>;
+
+template <class Key, class Value, class Compare = std::less<>>
+using mapped_split_map = basic_split_map<Key, Value, Compare, mapped_vector<Key>, mapped_vector<Value>>;
+
+} // namespace ist
+
+
+namespace std {
+
+template<class K, class V, class Comp, class KCont, class VCont>
+inline void swap(ist::basic_split_map<K, V, Comp, KCont, VCont>& l, ist::basic_split_map<K, V, Comp, KCont, VCont>& r) noexcept
+{
+    l.swap(r);
+}
+
+} // namespace std
@@ -4,6 +4,7 @@
 #include <charconv>
 #include <iterator>
 #include "vector_base.h"
+#include "string_search.h"
 
 namespace ist {
 
@@ -64,8 +65,10 @@ public:
     template<bool mapped = is_mapped_memory_v<super>, fc_require(mapped)>
     constexpr basic_string(void* data, size_t capacity, size_t size = 0)
         : super(data, capacity, size)
-        , basic_string()
     {
+        if (size < capacity) {
+            _null_terminate();
+        }
     }
 
     using super::capacity;
@@ -115,7 +118,7 @@ public:
     {
         size_t size = 0;
         _resize(n, [&](pointer addr) { size = op(addr, n); });
-        this->size_ = size;
+        this->_set_size(size);
     }
 
     constexpr void push_back(const_reference v)
@@ -403,6 +406,15 @@ public:
 
     constexpr size_t find_first_of(const_pointer str, size_t pos, size_t count) const noexcept
     {
+        if constexpr (_is_char_string) {
+            if (!fc_is_constant_evaluated()) {
+                if (pos >= size()) {
+                    return npos;
+                }
+                size_t r = _find_first_of_chars<true>(data() + pos, size() - pos, str, count);
+                return r == size() - pos ? npos : pos + r;
+            }
+        }
         auto it = _find_first_of(begin() + pos, end(), str, str + count, std::equal_to<>{});
         auto r = std::distance(begin(), it);
         return r == size() ? npos : r;
@@ -426,6 +438,15 @@ public:
 
     constexpr size_t find_first_not_of(const_pointer str, size_t pos, size_t count) const noexcept
     {
+        if constexpr (_is_char_string) {
+            if (!fc_is_constant_evaluated()) {
+                if (pos >= size()) {
+                    return npos;
+                }
+                size_t r = _find_first_of_chars<false>(data() + pos, size() - pos, str, count);
+                return r == size() - pos ? npos : pos + r;
+            }
+        }
         auto it = _find_first_not_of(begin() + pos, end(), str, str + count, std::equal_to<>{});
         auto r = std::distance(begin(), it);
         return r == size() ? npos : r;
@@ -449,6 +470,15 @@ public:
 
     constexpr size_t find_last_of(const_pointer str, size_t pos, size_t count) const noexcept
     {
+        if constexpr (_is_char_string) {
+            if (!fc_is_constant_evaluated()) {
+                if (pos >= size()) {
+                    return npos;
+                }
+                size_t r = _find_last_of_chars<true>(data() + pos, size() - pos, str, count);
+                return r == size() - pos ? npos : pos + r;
+            }
+        }
         auto it = _find_last_of(begin() + pos, end(), str, str + count, std::equal_to<>{});
         auto r = std::distance(begin(), it);
         return r == size() ? npos : r;
@@ -472,6 +502,15 @@ public:
 
     constexpr size_t find_last_not_of(const_pointer str, size_t pos, size_t count) const noexcept
     {
+        if constexpr (_is_char_string) {
+            if (!fc_is_constant_evaluated()) {
+                if (pos >= size()) {
+                    return npos;
+                }
+                size_t r = _find_last_of_chars<false>(data() + pos, size() - pos, str, count);
+                return r == size() - pos ? npos : pos + r;
+            }
+        }
         auto it = _find_last_not_of(begin() + pos, end(), str, str + count, std::equal_to<>{});
         auto r = std::distance(begin(), it);
         return r == size() ? npos : r;
@@ -533,7 +572,9 @@ public:
 
     constexpr int compare(size_t pos1, size_t count1, const_pointer str, size_t pos2, size_t count2) const noexcept
     {
-        return Traits::compare(data() + pos1, str + pos2, std::min(count1, count2));
+        count1 = std::min(count1, size() - pos1);
+        int r = Traits::compare(data() + pos1, str + pos2, std::min(count1, count2));
+        return r != 0 ? r : count1 < count2 ? -1 : count1 > count2 ? 1 : 0;
     }
     constexpr int compare(size_t pos1, size_t count1, const_pointer str) const noexcept
     {
@@ -547,7 +588,7 @@ public:
     template<class String, fc_require(is_string_like_v<String, value_type>)>
     constexpr int compare(size_t pos1, size_t count1, const String& str, size_t pos2, size_t count2 = npos) const noexcept
     {
-        count2 = count2 == npos ? str.size() - pos2 : count2;
+        count2 = std::min(count2, str.size() - pos2);
         return compare(pos1, count1, str.data(), pos2, count2);
     }
     template<class String, fc_require(is_string_like_v<String, value_type>)>
@@ -655,6 +696,9 @@ protected:
     using super::_insert;
     using super::_assign;
 
+    // plain char strings have SIMD fast paths (see string_search.h)
+    static constexpr bool _is_char_string = std::is_same_v<T, char> && std::is_same_v<Traits, std::char_traits<char>>;
+
     constexpr void _null_terminate()
     {
         reserve(size() + 1);
@@ -683,6 +727,12 @@ protected:
         if (size2 == 0) {
             return offset;
         }
+        if constexpr (_is_char_string) {
+            if (!fc_is_constant_evaluated()) {
+                size_t r = _find_substr(str1 + offset, size1 - offset, str2, size2);
+                return r == _substr_npos ? npos : offset + r;
+            }
+        }
 
         const auto end = str1 + (size1 - size2) + 1;
         for (auto s = str1 + offset;; ++s) {
@@ -956,18 +1006,32 @@ template<size_t Capacity> using sbo_wstring = basic_string<wchar_t, sbo_memory<w
 template<size_t Capacity> using sbo_u16string = basic_string<char16_t, sbo_memory<char16_t, Capacity>, std::char_traits<char16_t>>;
 template<size_t Capacity> using sbo_u32string = basic_string<char32_t, sbo_memory<char32_t, Capacity>, std::char_traits<char32_t>>;
 
+template<size_t Size = 24> using compact_string = basic_string<char, compact_string_memory<char, Size>, std::char_traits<char>>;
+
 using mapped_string_view = basic_string<char, mapped_memory<char>, std::char_traits<char>>;
 using mapped_wstring_view = basic_string<wchar_t, mapped_memory<wchar_t>, std::char_traits<wchar_t>>;
 using mapped_u16string_view = basic_string<char16_t, mapped_memory<char16_t>, std::char_traits<char16_t>>;
 using mapped_u32string_view = basic_string<char32_t, mapped_memory<char32_t>, std::char_traits<char32_t>>;
 
+using arena_string = basic_string<char, arena_memory<char>, std::char_traits<char>>;
+using arena_wstring = basic_string<wchar_t, arena_memory<wchar_t>, std::char_traits<wchar_t>>;
+using arena_u16string = basic_string<char16_t, arena_memory<char16_t>, std::char_traits<char16_t>>;
+using arena_u32string = basic_string<char32_t, arena_memory<char32_t>, std::char_traits<char32_t>>;
+
 #if __cpp_char8_t
 using u8string = basic_string<char8_t, dynamic_memory<char8_t>, std::char_traits<char8_t>>;
 template<size_t Capacity> using fixed_u8string = basic_string<char8_t, fixed_memory<char8_t, Capacity>, std::char_traits<char8_t>>;
 template<size_t Capacity> using sbo_u8string = basic_string<char8_t, sbo_memory<char8_t, Capacity>, std::char_traits<char8_t>>;
 using mapped_u8string = basic_string<char8_t, mapped_memory<char8_t>, std::char_traits<char8_t>>;
+template<size_t Size = 24> using compact_u8string = basic_string<char8_t, compact_string_memory<char8_t, Size>, std::char_traits<char8_t>>;
+using arena_u8string = basic_string<char8_t, arena_memory<char8_t>, std::char_traits<char8_t>>;
 #endif // __cpp_char8_t
 
+// compact strings don't point into themselves. containers of them can grow by realloc().
+// they still own heap buffers, so they are not is_pointer_free and can't be stored in files or snapshots.
+template<class T, size_t Size, class Growth, class Traits>
+struct is_trivially_relocatable<basic_string<T, compact_string_memory<T, Size, Growth>, Traits>> : std::true_type {};
+
 } // namespace ist
 
 
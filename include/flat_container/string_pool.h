@@ -0,0 +1,124 @@
+#pragma once
+#include <string_view>
+#include "string.h"
+#include "vector.h"
+#include "flat_hash_map.h"
+
+namespace ist {
+
+// string interning.
+// each unique string is copied once into arena blocks (null terminated), and identified by a 32 bit id.
+// ids are assigned in interning order, and ids & addresses of strings are stable until clear().
+// keying containers by ids makes comparison an integer compare. (see interned_less)
+// not thread safe.
+class string_pool
+{
+public:
+    using id_type = uint32_t;
+    static constexpr id_type npos = ~id_type(0);
+
+    explicit string_pool(size_t block_size = memory_arena::default_block_size) : arena_(block_size) {}
+    string_pool(const string_pool&) = delete;
+    string_pool& operator=(const string_pool&) = delete;
+
+    // returns the id of str. str is copied if it is new.
+    id_type intern(std::string_view str)
+    {
+        if (auto it = index_.find(str); it != index_.end()) {
+            return it->second;
+        }
+        if (strings_.size() >= npos) {
+            throw std::length_error("string_pool: too many strings");
+        }
+        char* dst = (char*)arena_.allocate(str.size() + 1, 1);
+        std::memcpy(dst, str.data(), str.size());
+        dst[str.size()] = 0;
+
+        std::string_view stored(dst, str.size());
+        id_type id = (id_type)strings_.size();
+        strings_.push_back(stored);
+        index_.insert({ stored, id });
+        return id;
+    }
+
+    // npos if str is not interned
+    id_type find(std::string_view str) const
+    {
+        auto it = index_.find(str);
+        return it != index_.end() ? it->second : npos;
+    }
+
+    std::string_view view(id_type id) const { return strings_[id]; }
+    const char* c_str(id_type id) const { return strings_[id].data(); }
+    // the view points into the pool. it must not be modified.
+    mapped_string_view get(id_type id) const
+    {
+        auto str = strings_[id];
+        return mapped_string_view((void*)str.data(), str.size() + 1, str.size());
+    }
+
+    // number of unique strings
+    size_t size() const noexcept { return strings_.size(); }
+    bool empty() const noexcept { return strings_.empty(); }
+
+    // invalidates all ids and strings.
+    void clear()
+    {
+        index_.clear();
+        strings_.clear();
+        arena_.reset();
+    }
+
+    // the pool set by string_pool_scope on this thread, or the thread local default pool.
+    // interned_less uses this to convert strings to ids.
+    static string_pool& current()
+    {
+        if (auto* r = _current()) {
+            return *r;
+        }
+        thread_local string_pool s_default;
+        return s_default;
+    }
+
+    static string_pool*& _current()
+    {
+        thread_local string_pool* s_current = nullptr;
+        return s_current;
+    }
+
+private:
+    memory_arena arena_;
+    vector<std::string_view> strings_; // indexed by id
+    flat_hash_map<std::string_view, id_type> index_;
+};
+
+// makes string_pool::current() return the pool while in the scope.
+class string_pool_scope
+{
+public:
+    explicit string_pool_scope(string_pool& pool) : prev_(string_pool::_current()) { string_pool::_current() = &pool; }
+    ~string_pool_scope() { string_pool::_current() = prev_; }
+    string_pool_scope(const string_pool_scope&) = delete;
+    string_pool_scope& operator=(const string_pool_scope&) = delete;
+
+private:
+    string_pool* prev_;
+};
+
+// transparent comparator for containers keyed by interned ids. e.g. flat_map<string_pool::id_type, V, interned_less>
+// ids are compared as integers, so the order is interning order, not alphabetical.
+// string keys are converted to ids by string_pool::current(), once per lookup by flat containers. (see has_to_key_v)
+// strings that are not interned become npos and are ordered after all ids, so find() returns end().
+struct interned_less
+{
+    using is_transparent = void;
+    using id_type = string_pool::id_type;
+
+    static id_type to_key(std::string_view v) { return string_pool::current().find(v); }
+
+    bool operator()(id_type a, id_type b) const noexcept { return a < b; }
+    bool operator()(id_type a, std::string_view b) const { return a < to_key(b); }
+    bool operator()(std::string_view a, id_type b) const { return to_key(a) < b; }
+};
+
+} // namespace ist
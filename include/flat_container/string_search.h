@@ -0,0 +1,364 @@
+#pragma once
+#include <cstring>
+#include <string_view>
+#include "simd.h"
+
+#if defined(__cpp_lib_is_constant_evaluated)
+#   define fc_is_constant_evaluated() std::is_constant_evaluated()
+#else
+#   define fc_is_constant_evaluated() false
+#endif
+
+namespace ist {
+
+// character set for find_first_of() family on char strings.
+// 256 bit lookup table for scalar path. SIMD path classifies 16 or 32 bytes per step:
+//  AVX2: nibble lookup with vpshufb. works with any set.
+//  SSE4.2: pcmpestrm. sets up to 16 chars.
+//  SSE2: compare with each char and or. sets up to 16 chars.
+class _char_set
+{
+public:
+#if defined(fc_avx2)
+    static constexpr size_t width = 32;
+#else
+    static constexpr size_t width = 16;
+#endif
+    static constexpr size_t max_simd_chars = 16;
+
+    _char_set(const char* chars, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t c = (uint8_t)chars[i];
+            bits_[c >> 6] |= uint64_t(1) << (c & 63);
+        }
+#if defined(fc_avx2)
+        // low nibble selects a byte of table, and the bit in it is selected by high nibble.
+        // table_lo is for high nibble 0-7, table_hi is for 8-15.
+        alignas(16) uint8_t lo[16]{}, hi[16]{};
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t c = (uint8_t)chars[i];
+            (c < 128 ? lo : hi)[c & 15] |= uint8_t(1 << ((c >> 4) & 7));
+        }
+        table_lo_ = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)lo));
+        table_hi_ = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)hi));
+        simd_ = true;
+#elif defined(fc_sse42)
+        if (n <= max_simd_chars) {
+            alignas(16) char tmp[16]{};
+            std::memcpy(tmp, chars, n);
+            set_ = _mm_load_si128((const __m128i*)tmp);
+            num_chars_ = (int)n;
+            simd_ = true;
+        }
+#elif defined(fc_sse2)
+        if (n <= max_simd_chars) {
+            for (size_t i = 0; i < n; ++i) {
+                chars_[i] = _mm_set1_epi8(chars[i]);
+            }
+            num_chars_ = (int)n;
+            simd_ = true;
+        }
+#endif
+    }
+
+    bool contains(uint8_t c) const
+    {
+        return (bits_[c >> 6] >> (c & 63)) & 1;
+    }
+
+    bool has_simd() const { return simd_; }
+
+    // bit mask of bytes in the set. requires has_simd().
+    uint32_t match(const char* p) const
+    {
+#if defined(fc_avx2)
+        const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+        const __m256i bit_table = _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i lo = _mm256_and_si256(v, nibble_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble_mask);
+        // msb of v tells high nibble >= 8
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(table_lo_, lo), _mm256_shuffle_epi8(table_hi_, lo), v);
+        __m256i bit = _mm256_shuffle_epi8(bit_table, hi);
+        __m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), _mm256_setzero_si256());
+        return ~(uint32_t)_mm256_movemask_epi8(none);
+#elif defined(fc_sse42)
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i m = _mm_cmpestrm(set_, num_chars_, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+        return (uint32_t)_mm_cvtsi128_si32(m);
+#elif defined(fc_sse2)
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i r = _mm_setzero_si128();
+        for (int i = 0; i < num_chars_; ++i) {
+            r = _mm_or_si128(r, _mm_cmpeq_epi8(v, chars_[i]));
+        }
+        return (uint32_t)_mm_movemask_epi8(r);
+#else
+        (void)p;
+        return 0;
+#endif
+    }
+
+private:
+#if defined(fc_avx2)
+    __m256i table_lo_, table_hi_;
+#elif defined(fc_sse42)
+    __m128i set_;
+    int num_chars_ = 0;
+#elif defined(fc_sse2)
+    __m128i chars_[max_simd_chars];
+    int num_chars_ = 0;
+#endif
+    uint64_t bits_[4]{};
+    bool simd_ = false;
+};
+
+// returns index of the first char in [0, n) that is in the set (Match) or not in the set (!Match). n if not found.
+template<bool Match>
+inline size_t _find_first_of_chars(const char* str, size_t n, const char* chars, size_t num_chars)
+{
+    _char_set set(chars, num_chars);
+    size_t i = 0;
+    if (set.has_simd()) {
+        const uint32_t all = _char_set::width == 32 ? ~0u : 0xffffu;
+        for (; i + _char_set::width <= n; i += _char_set::width) {
+            uint32_t m = set.match(str + i);
+            if (!Match) {
+                m = ~m & all;
+            }
+            if (m) {
+                return i + _ctz(m);
+            }
+        }
+    }
+    for (; i < n; ++i) {
+        if (set.contains((uint8_t)str[i]) == Match) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// returns index of the last char in [0, n) that is in the set (Match) or not in the set (!Match). n if not found.
+template<bool Match>
+inline size_t _find_last_of_chars(const char* str, size_t n, const char* chars, size_t num_chars)
+{
+    _char_set set(chars, num_chars);
+    size_t i = n;
+    if (set.has_simd()) {
+        const uint32_t all = _char_set::width == 32 ? ~0u : 0xffffu;
+        for (; i >= _char_set::width; i -= _char_set::width) {
+            uint32_t m = set.match(str + i - _char_set::width);
+            if (!Match) {
+                m = ~m & all;
+            }
+            if (m) {
+                return i - _char_set::width + _bsr(m);
+            }
+        }
+    }
+    while (i > 0) {
+        --i;
+        if (set.contains((uint8_t)str[i]) == Match) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// substring search.
+// SIMD path compares two chars of needle with 16 or 32 positions at once, and verifies only positions both match.
+// this skips most of false positives that make Traits::find() + Traits::compare() slow.
+// the second char is the last one that differs from the first, so needles like "aaa...a" don't match everywhere.
+// targets without SIMD use Boyer-Moore-Horspool for long needles. with SIMD, the filter was faster at any length
+// on both small and large alphabets, so Horspool is not used.
+
+constexpr size_t _substr_npos = ~size_t(0);
+#if defined(fc_sse2)
+constexpr size_t _horspool_threshold = ~size_t(0);
+#else
+// needles longer than this use Horspool
+constexpr size_t _horspool_threshold = 16;
+#endif
+
+// memcmp() == 0 without function call. candidates mostly differ in the first word.
+inline bool _substr_equal(const char* a, const char* b, size_t n)
+{
+    for (; n >= 8; n -= 8, a += 8, b += 8) {
+        uint64_t x, y;
+        std::memcpy(&x, a, 8);
+        std::memcpy(&y, b, 8);
+        if (x != y) {
+            return false;
+        }
+    }
+    for (; n > 0; --n, ++a, ++b) {
+        if (*a != *b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// offset of the second char to filter with
+inline size_t _substr_filter_offset(const char* needle, size_t m)
+{
+    for (size_t k = m - 1; k > 0; --k) {
+        if (needle[k] != needle[0]) {
+            return k;
+        }
+    }
+    return m - 1;
+}
+
+// m must be >= 2, and 0 < k < m
+inline size_t _find_substr_simd(const char* str, size_t n, const char* needle, size_t m, size_t k)
+{
+    size_t i = 0;
+#if defined(fc_avx2)
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i second = _mm256_set1_epi8(needle[k]);
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i f = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(str + i)));
+        __m256i s = _mm256_cmpeq_epi8(second, _mm256_loadu_si256((const __m256i*)(str + i + k)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(f, s));
+        while (mask) {
+            int b = _ctz(mask);
+            if (_substr_equal(str + i + b + 1, needle + 1, m - 1)) {
+                return i + b;
+            }
+            mask &= mask - 1;
+        }
+    }
+#elif defined(fc_sse2)
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i second = _mm_set1_epi8(needle[k]);
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i f = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(str + i)));
+        __m128i s = _mm_cmpeq_epi8(second, _mm_loadu_si128((const __m128i*)(str + i + k)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(f, s));
+        while (mask) {
+            int b = _ctz(mask);
+            if (_substr_equal(str + i + b + 1, needle + 1, m - 1)) {
+                return i + b;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i + m <= n; ++i) {
+        if (str[i] == needle[0] && str[i + k] == needle[k] && _substr_equal(str + i + 1, needle + 1, m - 1)) {
+            return i;
+        }
+    }
+    return _substr_npos;
+}
+
+inline void _build_horspool_table(uint32_t (&skip)[256], const char* needle, size_t m)
+{
+    for (auto& s : skip) {
+        s = (uint32_t)m;
+    }
+    for (size_t j = 0; j + 1 < m; ++j) {
+        skip[(uint8_t)needle[j]] = uint32_t(m - 1 - j);
+    }
+}
+
+inline size_t _find_substr_horspool(const char* str, size_t n, const char* needle, size_t m, const uint32_t (&skip)[256])
+{
+    const char last = needle[m - 1];
+    for (size_t i = 0; i + m <= n; ) {
+        char c = str[i + m - 1];
+        if (c == last && _substr_equal(str + i, needle, m - 1)) {
+            return i;
+        }
+        i += skip[(uint8_t)c];
+    }
+    return _substr_npos;
+}
+
+// returns position of needle in str, or _substr_npos
+inline size_t _find_substr(const char* str, size_t n, const char* needle, size_t m)
+{
+    if (m == 0) {
+        return 0;
+    }
+    if (m > n) {
+        return _substr_npos;
+    }
+    if (m == 1) {
+        auto* p = (const char*)std::memchr(str, needle[0], n);
+        return p ? size_t(p - str) : _substr_npos;
+    }
+    if (m > _horspool_threshold) {
+        uint32_t skip[256];
+        _build_horspool_table(skip, needle, m);
+        return _find_substr_horspool(str, n, needle, m, skip);
+    }
+    return _find_substr_simd(str, n, needle, m, _substr_filter_offset(needle, m));
+}
+
+// precompiled substring searcher for searching the same needle in many strings.
+// the needle is not copied. it must outlive the searcher.
+class string_searcher
+{
+public:
+    static constexpr size_t npos = _substr_npos;
+
+    string_searcher() {}
+    string_searcher(const char* needle, size_t size)
+        : needle_(needle), size_(size)
+    {
+        if (size_ > _horspool_threshold) {
+            _build_horspool_table(skip_, needle_, size_);
+        }
+        else if (size_ >= 2) {
+            offset_ = _substr_filter_offset(needle_, size_);
+        }
+    }
+    explicit string_searcher(std::string_view needle) : string_searcher(needle.data(), needle.size()) {}
+
+    // returns position of the needle in [str + pos, str + n), or npos
+    size_t find(const char* str, size_t n, size_t pos = 0) const
+    {
+        if (pos > n) {
+            return npos;
+        }
+        str += pos;
+        n -= pos;
+        size_t r;
+        if (size_ < 2 || size_ > n) {
+            r = _find_substr(str, n, needle_, size_);
+        }
+        else if (size_ > _horspool_threshold) {
+            r = _find_substr_horspool(str, n, needle_, size_, skip_);
+        }
+        else {
+            r = _find_substr_simd(str, n, needle_, size_, offset_);
+        }
+        return r == npos ? npos : pos + r;
+    }
+    size_t find(std::string_view str, size_t pos = 0) const
+    {
+        return find(str.data(), str.size(), pos);
+    }
+    template<class String, class = decltype(std::declval<const String&>().data())>
+    size_t find(const String& str, size_t pos = 0) const
+    {
+        return find(str.data(), str.size(), pos);
+    }
+
+    const char* data() const noexcept { return needle_; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    const char* needle_ = nullptr;
+    size_t size_ = 0;
+    size_t offset_ = 0;
+    uint32_t skip_[256];
+};
+
+} // namespace ist
@@ -23,6 +23,18 @@ inline constexpr void _destroy(const Iter first, const Iter last)
     std::destroy(first, last);
 }
 
+// tag to tell flat containers that input is already sorted and has no duplicates.
+// sorting and per-element insertion are skipped. (verified only if FC_ENABLE_SORTED_CHECK is defined)
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+inline constexpr sorted_unique_t sorted_unique{};
+
+// transparent comparators may provide static to_key(v) that converts a lookup key to the key type.
+// flat containers call it once per lookup instead of converting v in each comparison. (e.g. interned_less in string_pool.h)
+template<class Compare, class V, class = void>
+constexpr bool has_to_key_v = false;
+template<class Compare, class V>
+constexpr bool has_to_key_v<Compare, V, std::void_t<decltype(Compare::to_key(std::declval<const V&>()))>> = true;
+
 
 template<class Memory>
 class vector_base : public Memory
@@ -37,22 +49,38 @@ public:
     using iterator = pointer;
     using const_iterator = const_pointer;
 
+private:
+    // file backed containers can't be copied. (two objects can't own the same file)
+    // for them, copy functions take a dummy type, so they are not copy constructor & assignment,
+    // and the implicit ones are deleted because move constructor & assignment are declared.
+    struct _not_copyable {};
+    using _copy_source = std::conditional_t<is_file_mapped_memory_v<super>, _not_copyable, vector_base>;
+public:
+
 
     vector_base() {}
-    vector_base(const vector_base& r) { operator=(r); }
+    vector_base(const _copy_source& r) { operator=(r); }
     vector_base(vector_base&& r) noexcept { operator=(std::move(r)); }
     template<bool mapped = is_mapped_memory_v<super>, fc_require(mapped)>
     constexpr vector_base(void* data, size_t capacity, size_t size = 0)
         : super(data, capacity, size)
     {
     }
+    template<bool file = is_file_mapped_memory_v<super>, fc_require(file)>
+    explicit vector_base(const char* path, file_open_mode mode = file_open_mode::open_or_create)
+        : super(path, mode)
+    {
+    }
     ~vector_base()
     {
-        clear();
-        shrink_to_fit();
+        // file backed content must survive
+        if constexpr (!is_file_mapped_memory_v<super>) {
+            clear();
+            shrink_to_fit();
+        }
     }
 
-    vector_base& operator=(const vector_base& r)
+    vector_base& operator=(const _copy_source& r)
     {
         _assign(r.size(), [&](pointer dst) { _copy_range(dst, r.begin(), r.end()); });
         return *this;
@@ -65,13 +93,16 @@ public:
 
     constexpr void swap(vector_base& r)
     {
-        if constexpr (is_dynamic_memory_v<super> || is_mapped_memory_v<super>) {
+        if constexpr (is_file_mapped_memory_v<super> || is_packed_memory_v<super> || is_arena_memory_v<super>) {
+            this->_swap(r);
+        }
+        else if constexpr (is_dynamic_memory_v<super> || is_mapped_memory_v<super>) {
             std::swap(this->capacity_, r.capacity_);
             std::swap(this->size_, r.size_);
             std::swap(this->data_, r.data_);
         }
         else if constexpr (is_sbo_memory_v<super>) {
-            if (this->capacity_ > this->buffer_capacity_ && r.capacity_ > r.buffer_capacity_) {
+            if (this->capacity_ > this->buffer_capacity() && r.capacity_ > r.buffer_capacity()) {
                 std::swap(this->capacity_, r.capacity_);
                 std::swap(this->size_, r.size_);
                 std::swap(this->data_, r.data_);
@@ -87,11 +118,11 @@ public:
 
     void reserve(size_t n)
     {
-        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super>) {
-            if (n <= this->capacity_) {
+        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super> || is_packed_memory_v<super>) {
+            if (n <= _capacity()) {
                 return;
             }
-            size_t new_capaity = std::max<size_t>(n, this->capacity_ * 2);
+            size_t new_capaity = super::growth_policy::next_capacity(_capacity(), n, sizeof(value_type));
             _resize_capacity(new_capaity);
         }
     }
@@ -99,36 +130,36 @@ public:
     void shrink_to_fit()
     {
         if constexpr (is_dynamic_memory_v<super> || is_mapped_memory_v<super>) {
-            _resize_capacity(this->size_);
+            _resize_capacity(_size());
         }
     }
 
     constexpr void clear()
     {
-        _shrink(this->size_);
+        _shrink(_size());
     }
 
-    constexpr size_t capacity() const noexcept { return this->capacity_; }
-    constexpr size_t size() const noexcept { return this->size_; }
-    constexpr size_t size_bytes() const noexcept { return sizeof(value_type) * this->size_; }
-    constexpr pointer data() noexcept { return this->data_; }
-    constexpr const_pointer data() const noexcept { return this->data_; }
-
-    constexpr bool empty() const noexcept { return this->size_ == 0; }
-    constexpr iterator begin() noexcept { return this->data_; }
-    constexpr const_iterator begin() const noexcept { return this->data_; }
-    constexpr const_iterator cbegin() const noexcept { return this->data_; }
-    constexpr iterator end() noexcept { return this->data_ + this->size_; }
-    constexpr const_iterator end() const noexcept { return this->data_ + this->size_; }
-    constexpr const_iterator cend() const noexcept { return this->data_ + this->size_; }
-    constexpr reference at(size_t i) { _boundary_check(i); return this->data_[i]; }
-    constexpr const_reference at(size_t i) const { _boundary_check(i); return this->data_[i]; }
-    constexpr reference operator[](size_t i) { _boundary_check(i); return this->data_[i]; }
-    constexpr const_reference operator[](size_t i) const { _boundary_check(i); return this->data_[i]; }
-    constexpr reference front() { _boundary_check(1); return this->data_[0]; }
-    constexpr const_reference front() const { _boundary_check(1); return this->data_[0]; }
-    constexpr reference back() { _boundary_check(1); return this->data_[this->size_ - 1]; }
-    constexpr const_reference back() const { _boundary_check(1); return this->data_[this->size_ - 1]; }
+    constexpr size_t capacity() const noexcept { return _capacity(); }
+    constexpr size_t size() const noexcept { return _size(); }
+    constexpr size_t size_bytes() const noexcept { return sizeof(value_type) * _size(); }
+    constexpr pointer data() noexcept { return _data(); }
+    constexpr const_pointer data() const noexcept { return _data(); }
+
+    constexpr bool empty() const noexcept { return _size() == 0; }
+    constexpr iterator begin() noexcept { return _data(); }
+    constexpr const_iterator begin() const noexcept { return _data(); }
+    constexpr const_iterator cbegin() const noexcept { return _data(); }
+    constexpr iterator end() noexcept { return _data() + _size(); }
+    constexpr const_iterator end() const noexcept { return _data() + _size(); }
+    constexpr const_iterator cend() const noexcept { return _data() + _size(); }
+    constexpr reference at(size_t i) { _boundary_check(i); return _data()[i]; }
+    constexpr const_reference at(size_t i) const { _boundary_check(i); return _data()[i]; }
+    constexpr reference operator[](size_t i) { _boundary_check(i); return _data()[i]; }
+    constexpr const_reference operator[](size_t i) const { _boundary_check(i); return _data()[i]; }
+    constexpr reference front() { _boundary_check(1); return _data()[0]; }
+    constexpr const_reference front() const { _boundary_check(1); return _data()[0]; }
+    constexpr reference back() { _boundary_check(1); return _data()[_size() - 1]; }
+    constexpr const_reference back() const { _boundary_check(1); return _data()[_size() - 1]; }
 
     constexpr operator span<value_type>() const noexcept
     {
@@ -136,18 +167,63 @@ public:
     }
 
 protected:
+    // memory models hold data_, size_ and capacity_ as members, except for packed ones like compact_string_memory.
+    constexpr pointer _data() const noexcept
+    {
+        if constexpr (is_packed_memory_v<super>) {
+            return this->_get_data();
+        }
+        else {
+            return (pointer)this->data_;
+        }
+    }
+    constexpr size_t _size() const noexcept
+    {
+        if constexpr (is_packed_memory_v<super>) {
+            return this->_get_size();
+        }
+        else {
+            return this->size_;
+        }
+    }
+    constexpr size_t _capacity() const noexcept
+    {
+        if constexpr (is_packed_memory_v<super>) {
+            return this->_get_capacity();
+        }
+        else {
+            return this->capacity_;
+        }
+    }
+    constexpr void _set_size(size_t n) noexcept
+    {
+        if constexpr (is_packed_memory_v<super>) {
+            this->_put_size(n);
+        }
+        else {
+            this->size_ = n;
+        }
+    }
+    constexpr void _swap_size(vector_base& r) noexcept
+    {
+        size_t tmp = _size();
+        _set_size(r._size());
+        r._set_size(tmp);
+    }
+
     void _resize_capacity(size_t new_capaity)
     {
-        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super>) {
+        if constexpr (is_dynamic_memory_v<super> || is_sbo_memory_v<super> || is_packed_memory_v<super>) {
             this->_reallocate(new_capaity, [&](pointer new_data) {
-                size_t size_move = this->size_; // new_capacity is always >= this->size_
-                if constexpr (is_pod_v<value_type>) {
-                    std::memcpy(new_data, this->data_, sizeof(value_type) * size_move);
+                size_t size_move = _size(); // new_capacity is always >= _size()
+                fc_memory_stats(super, _copy(size_move, sizeof(value_type) * size_move));
+                if constexpr (is_pod_v<value_type> || is_trivially_relocatable_v<value_type>) {
+                    std::memcpy((void*)new_data, (const void*)_data(), sizeof(value_type) * size_move);
                 }
                 else {
                     for (size_t i = 0; i < size_move; ++i) {
-                        _construct_at<value_type>(new_data + i, std::move(this->data_[i]));
-                        _destroy_at(&this->data_[i]);
+                        _construct_at<value_type>(new_data + i, std::move(_data()[i]));
+                        _destroy_at(&_data()[i]);
                     }
                 }
                 });
@@ -167,7 +243,7 @@ protected:
         }
         else {
             size_t n = std::distance(first, last);
-            auto end_assign = std::min(dst + n, this->data_ + this->size_);
+            auto end_assign = std::min(dst + n, _data() + _size());
             auto end_new = dst + n;
             while (dst < end_assign) {
                 *dst++ = *first++;
@@ -186,7 +262,7 @@ protected:
             }
         }
         else {
-            auto end_assign = std::min(dst + n, this->data_ + this->size_);
+            auto end_assign = std::min(dst + n, _data() + _size());
             auto end_new = dst + n;
             while (dst < end_assign) {
                 *dst++ = v;
@@ -204,7 +280,7 @@ protected:
         }
         else {
             size_t n = std::distance(first, last);
-            auto end_assign = std::min(dst + n, this->data_ + this->size_);
+            auto end_assign = std::min(dst + n, _data() + _size());
             auto end_new = dst + n;
             while (dst < end_assign) {
                 *dst++ = std::move(*first++);
@@ -220,7 +296,7 @@ protected:
             *dst = v;
         }
         else {
-            if (dst >= this->data_ + this->size_) {
+            if (dst >= _data() + _size()) {
                 _construct_at<value_type>(dst, std::move(v));
             }
             else {
@@ -235,7 +311,7 @@ protected:
             *dst = value_type(std::forward<Args>(args)...);
         }
         else {
-            if (dst >= this->data_ + this->size_) {
+            if (dst >= _data() + _size()) {
                 _construct_at<value_type>(dst, std::forward<Args>(args)...);
             }
             else {
@@ -246,37 +322,37 @@ protected:
 
     constexpr void _swap_content(vector_base& r)
     {
-        size_t max_size = std::max(this->size_, r.size_);
+        size_t max_size = std::max(_size(), r._size());
         this->reserve(max_size);
         r.reserve(max_size);
 
         if constexpr (is_pod_v<value_type>) {
             size_t swap_count = max_size;
             for (size_t i = 0; i < swap_count; ++i) {
-                std::swap(this->data_[i], r[i]);
+                std::swap(_data()[i], r._data()[i]);
             }
-            std::swap(this->size_, r.size_);
+            _swap_size(r);
         }
         else {
-            size_t size1 = this->size_;
-            size_t size2 = r.size_;
+            size_t size1 = _size();
+            size_t size2 = r._size();
             size_t swap_count = std::min(size1, size2);
             for (size_t i = 0; i < swap_count; ++i) {
-                std::swap(this->data_[i], r[i]);
+                std::swap(_data()[i], r._data()[i]);
             }
             if (size1 < size2) {
                 for (size_t i = size1; i < size2; ++i) {
-                    _construct_at<value_type>(this->data_ + i, std::move(r[i]));
-                    _destroy_at(&r[i]);
+                    _construct_at<value_type>(_data() + i, std::move(r._data()[i]));
+                    _destroy_at(&r._data()[i]);
                 }
             }
             if (size2 < size1) {
                 for (size_t i = size2; i < size1; ++i) {
-                    _construct_at<value_type>(r.data_ + i, std::move(this->data_[i]));
-                    _destroy_at(&this->data_[i]);
+                    _construct_at<value_type>(r._data() + i, std::move(_data()[i]));
+                    _destroy_at(&_data()[i]);
                 }
             }
-            std::swap(this->size_, r.size_);
+            _swap_size(r);
         }
     }
 
@@ -285,43 +361,43 @@ protected:
     {
         this->reserve(n);
         _capacity_check(n);
-        construct(this->data_);
+        construct(_data());
         if constexpr (!is_pod_v<value_type>) {
-            if (n < this->size_) {
-                _destroy(this->data_ + n, this->data_ + this->size_);
+            if (n < _size()) {
+                _destroy(_data() + n, _data() + _size());
             }
         }
-        this->size_ = n;
+        _set_size(n);
     }
 
     constexpr void _shrink(size_t n)
     {
-        size_t new_size = this->size_ - n;
+        size_t new_size = _size() - n;
         _capacity_check(new_size);
         if constexpr (!is_pod_v<value_type>) {
-            _destroy(this->data_ + new_size, this->data_ + this->size_);
+            _destroy(_data() + new_size, _data() + _size());
         }
-        this->size_ = new_size;
+        _set_size(new_size);
     }
 
     template<class Construct>
     constexpr void _expand(size_t n, Construct&& construct)
     {
-        size_t new_size = this->size_ + n;
+        size_t new_size = _size() + n;
         this->reserve(new_size);
         _capacity_check(new_size);
-        construct(this->data_ + this->size_);
-        this->size_ = new_size;
+        construct(_data() + _size());
+        _set_size(new_size);
     }
 
     template<class Construct>
     constexpr void _resize(size_t n, Construct&& construct)
     {
-        if (n < this->size_) {
-            _shrink(this->size_ - n);
+        if (n < _size()) {
+            _shrink(_size() - n);
         }
-        else if (n > this->size_) {
-            size_t exn = n - this->size_;
+        else if (n > _size()) {
+            size_t exn = n - _size();
             _expand(exn, [&](pointer addr) {
                 for (size_t i = 0; i < exn; ++i) {
                     construct(addr + i);
@@ -333,12 +409,12 @@ protected:
     template<class Construct>
     constexpr iterator _insert(iterator pos, size_t s, Construct&& construct)
     {
-        size_t d = std::distance(this->data_, pos);
-        this->reserve(this->size_ + s);
-        pos = this->data_ + d; // for the case realloc happened
-        _move_backward(pos, this->data_ + this->size_, this->data_ + this->size_ + s);
+        size_t d = std::distance(_data(), pos);
+        this->reserve(_size() + s);
+        pos = _data() + d; // for the case realloc happened
+        _move_backward(pos, _data() + _size(), _data() + _size() + s);
         construct(pos);
-        this->size_ += s;
+        _set_size(_size() + s);
         return pos;
     }
 
@@ -355,7 +431,7 @@ protected:
             }
         }
         else {
-            auto end_new = this->data_ + this->size_;
+            auto end_new = _data() + _size();
             auto end_assign = dst - n;
             while (dst > end_new) {
                 _construct_at<value_type>(--dst, std::move(*(--last)));
@@ -370,7 +446,7 @@ protected:
     constexpr void _capacity_check(size_t n) const
     {
 #ifdef FC_ENABLE_CAPACITY_CHECK
-        if (n > this->capacity_) {
+        if (n > _capacity()) {
             throw std::out_of_range("out of capacity");
         }
 #endif
@@ -379,7 +455,7 @@ protected:
     constexpr void _boundary_check(size_t n) const
     {
 #ifdef FC_ENABLE_CAPACITY_CHECK
-        if (n > this->size_) {
+        if (n > _size()) {
             throw std::out_of_range("out of range");
         }
 #endif
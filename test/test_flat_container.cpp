@@ -1,14 +1,22 @@
 #include "Test.h"
 #include "flat_container/flat_set.h"
 #include "flat_container/flat_map.h"
+#include "flat_container/split_map.h"
+#include "flat_container/flat_hash_map.h"
 #include "flat_container/raw_vector.h"
 #include "flat_container/vector.h"
 #include "flat_container/string.h"
+#include "flat_container/mmap_memory.h"
+#include "flat_container/string_pool.h"
+#include "flat_container/set_operations.h"
 #include <set>
 #include <map>
 #include <memory>
 #include <unordered_map>
 #include <random>
+#include <deque>
+#include <sstream>
+#include <iterator>
 
 
 #if defined(_M_IX86) || defined(__i386__)
@@ -202,6 +210,832 @@ testCase(test_flat_map)
 }
 
 
+testCase(test_flat_map_bulk_insert)
+{
+    std::mt19937 rand(1);
+    std::vector<std::pair<const int, int>> src1, src2;
+    for (int i = 0; i < 1000; ++i) {
+        src1.push_back({ int(rand() % 500), i });
+        src2.push_back({ int(rand() % 2000), i });
+    }
+
+    std::map<int, int> smap;
+    ist::flat_map<int, int> fmap;
+    ist::sbo_map<int, int, 8> bmap;
+    ist::fixed_map<int, int, 1200> xmap; // holds the result, but not the result plus the temporary duplicates
+    ist::flat_set<int> fset;
+    ist::fixed_set<int, 1200> xset;
+
+    smap.insert(src1.begin(), src1.end());
+    fmap.insert(src1.begin(), src1.end());
+    bmap.insert(src1.begin(), src1.end());
+    xmap.insert(src1.begin(), src1.end());
+    smap.insert(src2.begin(), src2.end());
+    fmap.insert(src2.begin(), src2.end());
+    bmap.insert(src2.begin(), src2.end());
+    // size() + 1000 exceeds the capacity, so these fall back to one-by-one insertion
+    testExpect(xmap.size() + src2.size() > xmap.get().capacity());
+    xmap.insert(src2.begin(), src2.end());
+    {
+        std::vector<int> keys1, keys2;
+        for (auto& kvp : src1) { keys1.push_back(kvp.first); }
+        for (auto& kvp : src2) { keys2.push_back(kvp.first); }
+        xset.insert(keys1.begin(), keys1.end());
+        testExpect(xset.size() + keys2.size() > xset.get().capacity());
+        xset.insert(keys2.begin(), keys2.end());
+    }
+    for (auto& kvp : src1) { fset.insert(kvp.first); }
+    for (auto& kvp : src2) { fset.insert(kvp.first); }
+
+    testExpect(smap.size() == fmap.size());
+    testExpect(smap.size() == fset.size());
+    testExpect(std::equal(smap.begin(), smap.end(), fmap.begin(),
+        [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+    testExpect(fmap == bmap);
+    testExpect(fmap == xmap);
+    testExpect(std::equal(smap.begin(), smap.end(), xmap.begin(), xmap.end(),
+        [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+
+    std::vector<int> keys;
+    for (auto& kvp : smap) { keys.push_back(kvp.first); }
+    testExpect(std::equal(keys.begin(), keys.end(), fset.begin()));
+    testExpect(std::equal(keys.begin(), keys.end(), xset.begin(), xset.end()));
+
+    // single-pass input iterators
+    {
+        std::istringstream in("5 3 1 4 3");
+        ist::flat_set<int> iset;
+        iset.insert(std::istream_iterator<int>(in), std::istream_iterator<int>());
+        testExpect(iset.size() == 4);
+        testExpect(iset == ist::flat_set<int>({ 1, 3, 4, 5 }));
+    }
+}
+
+
+testCase(test_flat_map_sorted_unique)
+{
+    std::vector<std::pair<int, string>> sorted;
+    for (int i = 0; i < 100; ++i) {
+        sorted.push_back({ i * 2, string(std::to_string(i)) });
+    }
+
+    ist::flat_map<int, string> fmap(ist::sorted_unique, sorted);
+    testExpect(fmap.size() == sorted.size());
+    testExpect(fmap.find(10)->second == "5");
+
+    ist::fixed_map<int, string, 128> xmap(ist::sorted_unique, { {1, "a"}, {3, "c"}, {5, "e"} });
+    xmap.insert(ist::sorted_unique, { {0, "0"}, {3, "x"}, {4, "d"} });
+    testExpect(xmap.size() == 5);
+    testExpect(xmap.at(3) == "c");
+
+    ist::vector<int> keys{ 1, 2, 3, 5, 8, 13 };
+    auto* keys_data = keys.data();
+    ist::basic_set<int, std::less<>, ist::vector<int>> iset;
+    iset.adopt(std::move(keys));
+    testExpect(iset.size() == 6);
+    testExpect(iset.data() == keys_data); // ownership moved without copy
+    testExpect(iset.count(8) == 1);
+
+#ifdef FC_ENABLE_SORTED_CHECK
+    bool thrown = false;
+    try {
+        ist::flat_set<int> bad(ist::sorted_unique, { 3, 2, 1 });
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    testExpect(thrown);
+#endif
+}
+
+
+testCase(test_parallel_sort)
+{
+    // ranges larger than parallel_sort_min_chunk * threads are sorted & merged in parallel.
+    // the result must be the same as the single threaded path, including which duplicate is kept.
+    std::mt19937 rand(2);
+    const size_t n = ist::parallel_sort_min_chunk * 5 + 123;
+    std::vector<std::pair<const int, int>> src1, src2;
+    for (size_t i = 0; i < n; ++i) {
+        src1.push_back({ int(rand() % (n / 2)), int(i) });
+        src2.push_back({ int(rand() % n), int(i) });
+    }
+    std::map<int, int> smap;
+    smap.insert(src1.begin(), src1.end());
+    smap.insert(src2.begin(), src2.end());
+    std::vector<int> keys;
+    for (auto& kvp : smap) { keys.push_back(kvp.first); }
+
+    size_t prev = ist::get_parallel_threads();
+    for (size_t threads : { 1, 2, 3, 4, 7 }) {
+        ist::set_parallel_threads(threads);
+        testExpect(ist::get_parallel_threads() == threads);
+
+        ist::flat_map<int, int> fmap(src1.begin(), src1.end());
+        fmap.insert(src2.begin(), src2.end()); // merge with existing elements
+        testExpect(fmap.size() == smap.size());
+        testExpect(std::equal(smap.begin(), smap.end(), fmap.begin(),
+            [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+
+        std::vector<int> head, tail;
+        for (auto& kvp : src1) { head.push_back(kvp.first); }
+        for (auto& kvp : src2) { tail.push_back(kvp.first); }
+        ist::basic_set<int, std::less<>, ist::vector<int>> fset(head.begin(), head.end());
+        fset.insert(tail.begin(), tail.end());
+        testExpect(std::equal(keys.begin(), keys.end(), fset.begin(), fset.end()));
+
+        // swap(container) sorts and removes duplicates
+        std::vector<int> unsorted = tail;
+        ist::flat_set<int> sset;
+        sset.swap(unsorted);
+        std::set<int> tset(tail.begin(), tail.end());
+        testExpect(std::equal(tset.begin(), tset.end(), sset.begin(), sset.end()));
+
+        // so does the container constructor
+        std::vector<int> dup;
+        for (size_t i = 0; i < n; ++i) {
+            dup.push_back(int(rand() % 1000));
+        }
+        std::set<int> dset(dup.begin(), dup.end());
+        ist::flat_set<int> cset(std::move(dup));
+        testExpect(cset.size() == dset.size());
+        testExpect(std::equal(dset.begin(), dset.end(), cset.begin(), cset.end()));
+
+        ist::flat_map<int, int> cmap(std::vector<std::pair<int, int>>(src1.begin(), src1.end()));
+        std::map<int, int> smap1(src1.begin(), src1.end());
+        testExpect(std::equal(smap1.begin(), smap1.end(), cmap.begin(), cmap.end(),
+            [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+    }
+
+    // only contiguous ranges take the parallel path. others are sorted single threaded.
+    static_assert(ist::_is_parallel_sortable_v<int*> && ist::_is_parallel_sortable_v<std::vector<int>::iterator>);
+    static_assert(!ist::_is_parallel_sortable_v<std::deque<int>::iterator>);
+    {
+        ist::set_parallel_threads(4);
+        std::vector<int> head;
+        for (auto& kvp : src1) { head.push_back(kvp.first); }
+        ist::basic_set<int, std::less<>, std::deque<int>> dset(std::deque<int>(head.begin(), head.end()));
+        std::set<int> sset(head.begin(), head.end());
+        testExpect(std::equal(sset.begin(), sset.end(), dset.begin(), dset.end()));
+    }
+    ist::set_parallel_threads(prev);
+}
+
+testCase(test_set_operations)
+{
+    std::mt19937 rand(4);
+    // size pairs cover the linear merge, galloping on either side, empty sets and the SIMD tail.
+    const std::pair<size_t, size_t> sizes[] = { {0, 0}, {0, 10}, {10, 0}, {1, 1}, {7, 13}, {100, 100}, {1000, 3000}, {5, 5000}, {5000, 5}, {20000, 20000} };
+
+    auto check = [&](auto tag, auto gen) {
+        using Set = decltype(tag);
+        for (auto [na, nb] : sizes) {
+            std::vector<typename Set::value_type> va, vb;
+            for (size_t i = 0; i < na; ++i) { va.push_back(gen(na + nb)); }
+            for (size_t i = 0; i < nb; ++i) { vb.push_back(gen(na + nb)); }
+            Set a(va.begin(), va.end()), b(vb.begin(), vb.end());
+
+            auto expect = [&](auto op, const Set& r) {
+                std::vector<typename Set::value_type> e;
+                op(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(e));
+                return std::equal(e.begin(), e.end(), r.begin(), r.end());
+            };
+            using It = typename Set::const_iterator;
+            using Out = std::back_insert_iterator<std::vector<typename Set::value_type>>;
+            testExpect(expect(std::set_union<It, It, Out>, ist::set_union(a, b)));
+            testExpect(expect(std::set_intersection<It, It, Out>, ist::set_intersection(a, b)));
+            testExpect(expect(std::set_difference<It, It, Out>, ist::set_difference(a, b)));
+            testExpect(expect(std::set_symmetric_difference<It, It, Out>, ist::set_symmetric_difference(a, b)));
+
+            // into existing sets, including the operands themselves
+            Set r = a;
+            ist::set_intersection(a, b, r);
+            testExpect(r == ist::set_intersection(a, b));
+            Set c = a;
+            ist::set_union(c, b, c);
+            testExpect(c == ist::set_union(a, b));
+            Set d = b;
+            ist::set_difference(a, d, d);
+            testExpect(d == ist::set_difference(a, b));
+        }
+    };
+    check(ist::flat_set<uint64_t>(), [&](size_t n) { return uint64_t(rand() % (n + 1)) * 0x100000001ull; });
+    check(ist::flat_set<uint32_t>(), [&](size_t n) { return uint32_t(rand() % (n + 1)); });
+    check(ist::flat_set<int>(), [&](size_t n) { return int(rand() % (n + 1)) - int(n / 2); });
+    check(ist::basic_set<int64_t, std::less<>, ist::vector<int64_t>>(), [&](size_t n) { return -int64_t(rand() % (n + 1)); });
+    check(ist::sbo_set<uint32_t, 16>(), [&](size_t n) { return uint32_t(rand() % (n + 1)); });
+    check(ist::flat_set<std::string>(), [&](size_t n) { return std::to_string(rand() % (n + 1)); });
+
+    // maps are compared by keys. values come from a, or from whichever has the key.
+    ist::flat_map<int, std::string> ma{ {1, "a1"}, {2, "a2"}, {4, "a4"}, {7, "a7"} };
+    ist::flat_map<int, std::string> mb{ {2, "b2"}, {3, "b3"}, {7, "b7"}, {9, "b9"} };
+    using map_t = ist::flat_map<int, std::string>;
+    testExpect((ist::set_union(ma, mb) == map_t{ {1, "a1"}, {2, "a2"}, {3, "b3"}, {4, "a4"}, {7, "a7"}, {9, "b9"} }));
+    testExpect((ist::set_intersection(ma, mb) == map_t{ {2, "a2"}, {7, "a7"} }));
+    testExpect((ist::set_intersection(mb, ma) == map_t{ {2, "b2"}, {7, "b7"} }));
+    testExpect((ist::set_difference(ma, mb) == map_t{ {1, "a1"}, {4, "a4"} }));
+    testExpect((ist::set_symmetric_difference(ma, mb) == map_t{ {1, "a1"}, {3, "b3"}, {4, "a4"}, {9, "b9"} }));
+
+    // mapped sets & maps as the destination aliasing an operand. the result goes into the storage of dst.
+    {
+        int buf_a[8] = { 1, 3, 5, 7 }, buf_b[8] = { 2, 3, 4 };
+        ist::mapped_set<int> a(buf_a, 8, 4), b(buf_b, 8, 3);
+        ist::set_union(a, b, a);
+        testExpect(a.size() == 6 && a.data() == buf_a);
+        testExpect(a == ist::flat_set<int>({ 1, 2, 3, 4, 5, 7 }));
+        ist::set_difference(a, b, b);
+        testExpect(b.size() == 3 && b.data() == buf_b);
+        testExpect(b == ist::flat_set<int>({ 1, 5, 7 }));
+        ist::set_intersection(a, b, a);
+        testExpect(a == ist::flat_set<int>({ 1, 5, 7 }));
+
+        // doesn't fit. dst is left as is.
+        int buf_c[4] = { 0, 2, 4, 6 }, buf_d[4] = { 1, 3, 5, 7 };
+        ist::mapped_set<int> c(buf_c, 4, 4), d(buf_d, 4, 4);
+        bool thrown = false;
+        try {
+            ist::set_union(c, d, c);
+        }
+        catch (const std::out_of_range&) {
+            thrown = true;
+        }
+        testExpect(thrown && c.size() == 4 && c.data() == buf_c);
+
+        std::pair<int, int> buf_m[8] = { {1, 10}, {2, 20} }, buf_n[8] = { {2, 0}, {3, 30} };
+        ist::mapped_map<int, int> m(buf_m, 8, 2), n(buf_n, 8, 2);
+        ist::set_symmetric_difference(m, n, n);
+        testExpect(n.size() == 2 && n.get().data() == buf_n && n.at(1) == 10 && n.at(3) == 30);
+    }
+}
+
+testCase(test_find_many)
+{
+    std::mt19937 rand(5);
+    for (size_t size : { 0, 10, 1000, 100000 }) {
+        std::vector<int> src;
+        for (size_t i = 0; i < size; ++i) {
+            src.push_back(int(i * 2));
+        }
+        ist::flat_set<int> set(ist::sorted_unique, src.begin(), src.end());
+        ist::flat_map<int, int> map;
+        for (int v : src) {
+            map.insert({ v, -v });
+        }
+
+        // hits, misses and out of range keys, shuffled and sorted (with duplicates)
+        std::vector<int> keys;
+        for (size_t i = 0; i < 1000; ++i) {
+            keys.push_back(int(rand() % (size * 2 + 3)) - 1);
+        }
+        std::vector<int> sorted_keys = keys;
+        std::sort(sorted_keys.begin(), sorted_keys.end());
+
+        for (auto* k : { &keys, &sorted_keys }) {
+            std::vector<ist::flat_set<int>::const_iterator> rs;
+            set.find_many(*k, std::back_inserter(rs));
+            testExpect(rs.size() == k->size());
+            bool ok = true;
+            for (size_t i = 0; i < k->size(); ++i) {
+                ok = ok && rs[i] == set.find((*k)[i]);
+            }
+            testExpect(ok);
+
+            rs.clear();
+            set.lower_bound_many(ist::vector<int>(k->begin(), k->end()), std::back_inserter(rs));
+            ok = true;
+            for (size_t i = 0; i < k->size(); ++i) {
+                ok = ok && rs[i] == set.lower_bound((*k)[i]);
+            }
+            testExpect(ok);
+
+            std::vector<ist::flat_map<int, int>::iterator> rm(k->size());
+            map.find_many(*k, rm.begin());
+            ok = true;
+            for (size_t i = 0; i < k->size(); ++i) {
+                ok = ok && rm[i] == map.find((*k)[i]);
+            }
+            testExpect(ok);
+
+            map.lower_bound_many(*k, rm.begin());
+            ok = true;
+            for (size_t i = 0; i < k->size(); ++i) {
+                ok = ok && rm[i] == map.lower_bound((*k)[i]);
+            }
+            testExpect(ok);
+        }
+    }
+
+    // heterogeneous keys
+    ist::flat_map<std::string, int> smap{ {"apple", 1}, {"banana", 2}, {"cherry", 3} };
+    std::string_view skeys[] = { "cherry", "apple", "durian" };
+    ist::flat_map<std::string, int>::iterator sr[3];
+    smap.find_many(skeys, sr);
+    testExpect(sr[0]->second == 3 && sr[1]->second == 1 && sr[2] == smap.end());
+    sr[0]->second = 30;
+    testExpect(smap["cherry"] == 30);
+}
+
+testCase(test_split_map)
+{
+    std::map<string, int> smap;
+    ist::split_map<string, int> fmap;
+    ist::fixed_split_map<string, int, 32> xmap;
+    ist::sbo_split_map<string, int, 8> bmap;
+
+    std::byte kbuf[sizeof(string) * 32];
+    std::byte vbuf[sizeof(int) * 32];
+    ist::mapped_split_map<string, int> vmap(kbuf, vbuf, 32);
+
+    auto check = [&]() {
+        testExpect(smap.size() == fmap.size());
+        testExpect(smap.size() == xmap.size());
+        testExpect(smap.size() == bmap.size());
+        testExpect(smap.size() == vmap.size());
+
+        auto i1 = smap.begin();
+        auto i2 = fmap.begin();
+        auto i3 = xmap.begin();
+        auto i4 = bmap.begin();
+        auto i5 = vmap.begin();
+        while (i1 != smap.end()) {
+            testExpect(i1->first == i2->first); testExpect(i1->second == i2->second);
+            testExpect(i1->first == i3->first); testExpect(i1->second == i3->second);
+            testExpect(i1->first == i4->first); testExpect(i1->second == i4->second);
+            testExpect(i1->first == i5->first); testExpect(i1->second == i5->second);
+            ++i1; ++i2; ++i3; ++i4; ++i5;
+        }
+        for (auto& kvp : smap) {
+            testExpect(fmap.at(kvp.first) == kvp.second);
+            testExpect(xmap.find(kvp.first).value() == kvp.second);
+        }
+    };
+    auto insert = [&](const std::pair<string, int>& v) {
+        smap.insert(v);
+        fmap.insert(v);
+        xmap.insert(v);
+        bmap.insert(v);
+        vmap.insert(v);
+    };
+    auto insert_il = [&](std::initializer_list<std::pair<const string, int>>&& v) {
+        smap.insert(v);
+        fmap.insert(v);
+        xmap.insert(v);
+        bmap.insert(v);
+        vmap.insert(v);
+    };
+    auto erase = [&](const string& v) {
+        smap.erase(v);
+        fmap.erase(v);
+        xmap.erase(v);
+        bmap.erase(v);
+        vmap.erase(v);
+    };
+
+    std::pair<string, int> data[]{
+        {"a", 10},
+        {"c", 3},
+        {"e", 50},
+        {"d", 4},
+        {"b", 20},
+        {"b", 2},
+        {"d", 40},
+        {"e", 5},
+        {"c", 30},
+        {"a", 1},
+    };
+
+    for (auto& v : data) {
+        insert(v);
+    }
+    insert_il({ {"abc", 100}, {"def", 200}, {"a", 300}, {"jkl", 400}, {"abc", 500} });
+    check();
+
+    erase("c");
+    erase("a");
+    erase("x");
+    check();
+
+    fmap["z"] = 1;
+    testExpect(fmap.at("z") == 1);
+    testExpect(fmap.upper_bound("e") == fmap.find("jkl"));
+    testExpect(fmap.keys().size() == fmap.values().size());
+}
+
+
+testCase(test_arena_memory)
+{
+    ist::memory_arena arena;
+    {
+        ist::arena_scope scope(arena);
+        testExpect(&ist::memory_arena::current() == &arena);
+
+        // the last allocation of the arena grows in place
+        ist::arena_vector<int> vec;
+        testExpect(&vec.arena() == &arena);
+        vec.push_back(0);
+        auto* first = vec.data();
+        for (int i = 1; i < 200; ++i) {
+            vec.push_back(i);
+        }
+        testExpect(vec.data() == first);
+        for (int i = 0; i < 200; ++i) {
+            testExpect(vec[i] == i);
+        }
+
+        // not the last allocation anymore. grows by copy.
+        ist::arena_string str = "abcdefg";
+        vec.resize(1000, 1);
+        testExpect(vec.data() != first);
+        testExpect(vec[199] == 199 && vec[999] == 1);
+        str += "hijklmn";
+        testExpect(str == "abcdefghijklmn");
+
+        ist::arena_map<ist::arena_string, int> map;
+        map["abc"] = 1;
+        map["def"] = 2;
+        map["abc"] = 3;
+        testExpect(map.size() == 2 && map.at("abc") == 3);
+
+        {
+            // nested scope
+            ist::memory_arena arena2;
+            ist::arena_scope scope2(arena2);
+            ist::arena_vector<int> vec2(10, 1);
+            testExpect(&vec2.arena() == &arena2);
+
+            // memory goes with its arena on swap
+            vec2.swap(vec);
+            testExpect(&vec.arena() == &arena2 && &vec2.arena() == &arena);
+            testExpect(vec.size() == 10 && vec2.size() == 1000 && vec2[199] == 199);
+            vec2.push_back(1);
+            vec.swap(vec2);
+            testExpect(&vec.arena() == &arena && vec.size() == 1001);
+
+            ist::arena_hash_map<int, int> hmap2;
+            hmap2[1] = 1;
+            {
+                ist::arena_scope scope3(arena);
+                ist::arena_hash_map<int, int> hmap;
+                for (int i = 0; i < 100; ++i) {
+                    hmap[i] = i;
+                }
+                hmap.swap(hmap2);
+                testExpect(&hmap.arena() == &arena2 && &hmap2.arena() == &arena);
+                testExpect(hmap.size() == 1 && hmap2.size() == 100 && hmap2.at(99) == 99);
+                hmap2 = std::move(hmap);
+                testExpect(&hmap2.arena() == &arena2 && hmap2.size() == 1);
+                hmap[200] = 200;
+                testExpect(&hmap.arena() == &arena && hmap.at(200) == 200);
+            }
+        }
+        testExpect(&ist::memory_arena::current() == &arena);
+    }
+    testExpect(&ist::memory_arena::current() != &arena);
+    arena.reset();
+
+    // external buffer as the first block
+    alignas(16) std::byte buf[512];
+    ist::memory_arena arena3(buf, sizeof(buf));
+    void* p1 = arena3.allocate(100);
+    testExpect(p1 >= buf && p1 < buf + sizeof(buf));
+    void* p2 = arena3.allocate(1000, 64);
+    testExpect((p2 < buf || p2 >= buf + sizeof(buf)) && (uintptr_t)p2 % 64 == 0);
+    arena3.reset();
+    testExpect(arena3.allocate(100) == p1);
+}
+
+
+// not trivially copyable, but safe to relocate by memcpy
+struct relocatable_obj
+{
+    static inline int num_moved = 0;
+
+    int* value;
+
+    relocatable_obj(int v = 0) : value(new int(v)) {}
+    relocatable_obj(const relocatable_obj& r) : value(new int(*r.value)) {}
+    relocatable_obj(relocatable_obj&& r) noexcept : value(r.value) { r.value = nullptr; ++num_moved; }
+    relocatable_obj& operator=(const relocatable_obj& r) { *value = *r.value; return *this; }
+    ~relocatable_obj() { delete value; }
+};
+namespace ist {
+template<> struct is_trivially_relocatable<relocatable_obj> : std::true_type {};
+} // namespace ist
+
+testCase(test_realloc_growth)
+{
+    static_assert(ist::is_trivially_relocatable_v<std::pair<int, float>>);
+    static_assert(!ist::is_trivially_relocatable_v<std::string>);
+
+    {
+        ist::raw_vector<uint8_t> buf;
+        for (int i = 0; i < 100000; ++i) {
+            buf.push_back(uint8_t(i));
+        }
+        for (int i = 0; i < 100000; ++i) {
+            testExpect(buf[i] == uint8_t(i));
+        }
+        buf.resize(10);
+        buf.shrink_to_fit();
+        testExpect(buf.capacity() == 10 && buf[9] == 9);
+    }
+    {
+        // elements are relocated by realloc(), not by move constructor
+        relocatable_obj::num_moved = 0;
+        ist::vector<relocatable_obj> objs;
+        for (int i = 0; i < 1000; ++i) {
+            objs.emplace_back(i);
+        }
+        testExpect(relocatable_obj::num_moved == 0);
+        for (int i = 0; i < 1000; ++i) {
+            testExpect(*objs[i].value == i);
+        }
+
+        ist::sbo_vector<relocatable_obj, 4> sobjs;
+        for (int i = 0; i < 1000; ++i) {
+            sobjs.emplace_back(i);
+        }
+        testExpect(relocatable_obj::num_moved == 0);
+        for (int i = 0; i < 1000; ++i) {
+            testExpect(*sobjs[i].value == i);
+        }
+    }
+}
+
+
+testCase(test_growth_policy)
+{
+    static_assert(ist::growth_2x::next_capacity(10, 11, 4) == 20);
+    static_assert(ist::growth_2x::next_capacity(10, 30, 4) == 30);
+    static_assert(ist::growth_1_5x::next_capacity(10, 11, 4) == 15);
+    static_assert(ist::growth_fixed<8>::next_capacity(10, 11, 4) == 18);
+    static_assert(ist::growth_page_round<>::next_capacity(10, 11, 4) == 1024);
+    static_assert(ist::growth_page_round<ist::growth_1_5x, 64>::next_capacity(100, 101, 8) == 152);
+
+    auto check = [](auto& vec) {
+        for (int i = 0; i < 10000; ++i) {
+            vec.push_back(i);
+            testExpect(vec.capacity() >= vec.size());
+        }
+        for (int i = 0; i < 10000; ++i) {
+            testExpect(vec[i] == i);
+        }
+    };
+    {
+        ist::basic_vector<int, ist::dynamic_memory<int, ist::growth_1_5x>> vec;
+        check(vec);
+    }
+    {
+        ist::basic_vector<int, ist::dynamic_memory<int, ist::growth_fixed<100>>> vec;
+        check(vec);
+        testExpect(vec.capacity() == 10000);
+    }
+    {
+        ist::basic_raw_vector<int, ist::dynamic_memory<int, ist::growth_page_round<>>> vec;
+        check(vec);
+        testExpect(vec.capacity() * sizeof(int) % 4096 == 0);
+    }
+    {
+        ist::basic_vector<int, ist::sbo_memory<int, 8, ist::growth_usable_size<>>> vec;
+        check(vec);
+        vec.shrink_to_fit();
+        testExpect(vec[9999] == 9999);
+    }
+    {
+        ist::basic_string<char, ist::dynamic_memory<char, ist::growth_usable_size<ist::growth_1_5x>>> str;
+        for (int i = 0; i < 1000; ++i) {
+            str += 'a';
+        }
+        testExpect(str.size() == 1000 && str.capacity() >= 1000 && str.back() == 'a');
+    }
+}
+
+testCase(test_memory_stats)
+{
+    using namespace ist;
+#ifdef FC_ENABLE_MEMORY_STATS
+    {
+        // trivially relocatable elements grow by realloc(). nothing is copied by the container.
+        using memory_t = dynamic_memory<uint16_t>;
+        reset_memory_stats<memory_t>();
+        size_t live = get_memory_stats<memory_t>().live_bytes;
+        {
+            basic_vector<uint16_t, memory_t> vec;
+            for (int i = 0; i < 1000; ++i) {
+                vec.push_back(uint16_t(i));
+            }
+            auto st = get_memory_stats<memory_t>();
+            testExpect(st.allocations == 1 && st.reallocations > 0);
+            testExpect(st.reallocation_copies == 0 && st.moved_elements == 0);
+            testExpect(st.bytes_requested >= sizeof(uint16_t) * 1000);
+            testExpect(st.peak_bytes >= live + sizeof(uint16_t) * 1000 || st.peak_bytes == 0);
+        }
+        auto st = get_memory_stats<memory_t>();
+        testExpect(st.deallocations == 1 && st.live_bytes == live);
+    }
+    {
+        // std::string is moved element by element
+        using memory_t = dynamic_memory<std::string>;
+        reset_memory_stats<memory_t>();
+        basic_vector<std::string, memory_t> vec;
+        for (int i = 0; i < 100; ++i) {
+            vec.push_back(std::to_string(i));
+        }
+        auto st = get_memory_stats<memory_t>();
+        testExpect(st.reallocation_copies == st.allocations - 1);
+        testExpect(st.moved_elements > 0 && st.moved_elements < 200);
+        testExpect(st.moved_bytes == st.moved_elements * sizeof(std::string));
+    }
+    {
+        using memory_t = sbo_memory<uint16_t, 8>;
+        reset_memory_stats<memory_t>();
+        basic_vector<uint16_t, memory_t> vec;
+        for (int i = 0; i < 8; ++i) {
+            vec.push_back(uint16_t(i));
+        }
+        testExpect(get_memory_stats<memory_t>().sbo_spills == 0);
+        for (int i = 0; i < 100; ++i) {
+            vec.push_back(uint16_t(i));
+        }
+        testExpect(get_memory_stats<memory_t>().sbo_spills == 1);
+
+        using string_memory_t = compact_string_memory<char, 24>;
+        reset_memory_stats<string_memory_t>();
+        compact_string<24> str("0123456789");
+        testExpect(get_memory_stats<string_memory_t>().sbo_spills == 0);
+        str += "0123456789abcdef";
+        auto st = get_memory_stats<string_memory_t>();
+        testExpect(st.sbo_spills == 1 && st.allocations == 1 && st.moved_elements == 10);
+    }
+
+    // dump
+    size_t num_types = 0;
+    for_each_memory_stats([&](std::string_view type, const memory_stats& st) {
+        testPrint("    %.*s: %zu allocs, %zu reallocs (%zu moved), %zu copies (%zu elements), %zu spills, peak %zu bytes\n",
+            (int)type.size(), type.data(), st.allocations, st.reallocations, st.reallocation_moves,
+            st.reallocation_copies, st.moved_elements, st.sbo_spills, st.peak_bytes);
+        num_types += type.find("dynamic_memory<short unsigned int") != std::string_view::npos ||
+            type.find("dynamic_memory<unsigned short") != std::string_view::npos;
+    });
+    testExpect(num_types == 1);
+#else
+    // statistics are disabled. the API is still available.
+    basic_vector<uint16_t, dynamic_memory<uint16_t>> vec(100);
+    testExpect(get_memory_stats<dynamic_memory<uint16_t>>().allocations == 0);
+#endif
+}
+
+testCase(test_mmap_memory)
+{
+    {
+        // data never moves while growing
+        ist::mmap_raw_vector<uint32_t> vec;
+        vec.push_back(0);
+        const uint32_t* data = vec.data();
+        const size_t n = 1 << 22;
+        for (size_t i = 1; i < n; ++i) {
+            vec.push_back(uint32_t(i));
+        }
+        testExpect(vec.data() == data);
+        for (size_t i = 0; i < n; ++i) {
+            testExpect(vec[i] == uint32_t(i));
+        }
+
+        // pages beyond size are returned to the OS, and can be committed again
+        vec.resize(1000);
+        vec.shrink_to_fit();
+        testExpect(vec.data() == data);
+        testExpect(vec.capacity() >= 1000 && vec.capacity() * sizeof(uint32_t) % 4096 == 0);
+        testExpect(vec[999] == 999);
+        vec.resize(n, 1);
+        testExpect(vec.data() == data && vec[999] == 999 && vec[n - 1] == 1);
+
+        vec.clear();
+        vec.shrink_to_fit();
+        testExpect(vec.data() == nullptr && vec.capacity() == 0);
+    }
+    {
+        // exceeding reserved range throws
+        ist::mmap_vector<int, 1024 * 1024> vec;
+        bool thrown = false;
+        try {
+            vec.resize(1024 * 1024);
+        }
+        catch (const std::bad_alloc&) {
+            thrown = true;
+        }
+        testExpect(thrown);
+    }
+    {
+        ist::mmap_vector<std::string, (size_t(1) << 30), ist::mmap_huge_page> strs;
+        for (int i = 0; i < 10000; ++i) {
+            strs.push_back(std::to_string(i));
+        }
+        testExpect((uintptr_t)strs.data() % (2 * 1024 * 1024) == 0);
+        testExpect(strs[1234] == "1234");
+        auto strs2 = strs;
+        testExpect(strs2 == strs && strs2.data() != strs.data());
+    }
+}
+
+testCase(test_file_mapped_memory)
+{
+    const char* vec_path = "test_file_vector.bin";
+    const char* map_path = "test_file_map.bin";
+    const char* set_path = "test_file_set.bin";
+    const int n = 100000;
+    // two objects can't own the same file
+    static_assert(!std::is_copy_constructible_v<ist::file_vector<int>> && !std::is_copy_assignable_v<ist::file_vector<int>>);
+    static_assert(std::is_copy_constructible_v<ist::vector<int>> && std::is_copy_assignable_v<ist::sbo_vector<int, 8>>);
+    {
+        ist::file_vector<int> vec(vec_path, ist::file_open_mode::create);
+        for (int i = 0; i < n; ++i) {
+            vec.push_back(i);
+        }
+        vec.sync();
+
+        ist::file_map<int, double> map(map_path, ist::file_open_mode::create);
+        for (int i = 0; i < 1000; ++i) {
+            map[i * 2] = i * 0.5;
+        }
+
+        ist::file_set<uint64_t> set(set_path, ist::file_open_mode::create);
+        set.insert({ 5, 3, 1, 3 });
+    }
+    {
+        // content survives the container
+        ist::file_vector<int> vec(vec_path, ist::file_open_mode::open);
+        testExpect(vec.size() == n);
+        for (int i = 0; i < n; ++i) {
+            testExpect(vec[i] == i);
+        }
+        vec.resize(10);
+        vec.shrink_to_fit();
+
+        auto vec2 = std::move(vec);
+        testExpect(vec2.size() == 10 && vec2.is_open() && !vec.is_open());
+
+        ist::file_map<int, double> map(map_path);
+        testExpect(map.size() == 1000);
+        testExpect(map.at(10) == 2.5);
+        testExpect(map.find(11) == map.end());
+        map.erase(10);
+        map.insert({ 11, 1.0 });
+
+        ist::file_set<uint64_t> set(set_path);
+        testExpect(set.size() == 3 && set.count(3) == 1 && set.count(2) == 0);
+    }
+    {
+        ist::file_raw_vector<int> vec(vec_path);
+        testExpect(vec.size() == 10 && vec.capacity() == 10 && vec[9] == 9);
+
+        ist::file_map<int, double> map(map_path);
+        testExpect(map.size() == 1000 && map.count(10) == 0 && map.at(11) == 1.0);
+    }
+    {
+        // element type mismatch
+        bool thrown = false;
+        try {
+            ist::file_vector<uint8_t> vec(vec_path);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        testExpect(thrown);
+        // the header is left as is
+        ist::file_vector<int> vec(vec_path);
+        testExpect(vec.size() == 10);
+    }
+    {
+        // a small file that is not ours must be left untouched
+        const char* txt_path = "test_file_small.txt";
+        if (FILE* f = std::fopen(txt_path, "wb")) {
+            std::fputs("hello", f);
+            std::fclose(f);
+        }
+        bool thrown = false;
+        try {
+            ist::file_vector<int> vec(txt_path, ist::file_open_mode::open);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        testExpect(thrown);
+
+        char buf[16]{};
+        if (FILE* f = std::fopen(txt_path, "rb")) {
+            buf[std::fread(buf, 1, sizeof(buf) - 1, f)] = 0;
+            std::fclose(f);
+        }
+        testExpect(std::strcmp(buf, "hello") == 0);
+        std::remove(txt_path);
+    }
+    std::remove(vec_path);
+    std::remove(map_path);
+    std::remove(set_path);
+}
+
+
 testCase(test_fixed_vector)
 {
     printf("is_mapped_memory_v<ist::fixed_vector<int, 8>>: %d\n",
@@ -566,4 +1400,236 @@ testCase(test_fixed_string)
         auto xyz = abc.substr(2, 3);
         testExpect(xyz == "xyz");
     }
+    {
+        // counts past the end are clamped, same as std::string
+        ist::string hello = "hello";
+        testExpect(hello.compare(0, ist::string::npos, "hello") == 0);
+        testExpect(hello.compare(1, 10, "ello") == 0);
+        testExpect(hello.compare(1, 10, std::string_view("xello"), 1) == 0);
+        testExpect(hello.compare("hell") > 0);
+        testExpect(hello.compare("hello!") < 0);
+        testExpect(hello.compare(0, 4, "hello") < 0);
+    }
+}
+
+testCase(test_compact_string)
+{
+    static_assert(sizeof(ist::compact_string<24>) == 24);
+    static_assert(sizeof(ist::compact_string<32>) == 32);
+    static_assert(ist::is_trivially_relocatable_v<ist::compact_string<24>> && !ist::is_pointer_free_v<ist::compact_string<24>>);
+
+    // random edits, compared with std::string. lengths cross the inline / heap boundary both ways.
+    auto check = [](auto tag) {
+        using String = decltype(tag);
+        std::mt19937 rand(7);
+        String istr;
+        std::string sstr;
+        testExpect(istr.capacity() == String::inline_capacity);
+        for (int i = 0; i < 5000; ++i) {
+            switch (rand() % 6) {
+            case 0: { char c = char('a' + rand() % 26); istr.push_back(c); sstr.push_back(c); break; }
+            case 1: if (!sstr.empty()) { istr.pop_back(); sstr.pop_back(); } break;
+            case 2: { std::string a(rand() % 12, char('A' + rand() % 26)); istr += a.c_str(); sstr += a; break; }
+            case 3: { size_t n = rand() % 40; istr.resize(n, 'x'); sstr.resize(n, 'x'); break; }
+            case 4: { size_t p = sstr.empty() ? 0 : rand() % sstr.size(); size_t n = std::min<size_t>(3, sstr.size() - p); istr.erase(p, n); sstr.erase(p, n); break; }
+            case 5: { String t = istr; istr = std::move(t); break; }
+            }
+            testExpect(istr.size() == sstr.size());
+            testExpect(std::string_view(istr) == sstr);
+            testExpect(istr.c_str()[istr.size()] == 0);
+        }
+
+        // inline up to Size - 2 chars
+        String a(String::inline_capacity - 1, 'a');
+        testExpect((void*)a.data() == (void*)&a);
+        String b(String::inline_capacity, 'b');
+        testExpect((void*)b.data() != (void*)&b);
+        a.swap(b);
+        testExpect(a.size() == String::inline_capacity && b.size() == String::inline_capacity - 1);
+        testExpect((void*)b.data() == (void*)&b);
+        b = a;
+        testExpect(a == b);
+
+        // the null terminator moves with the content on reserve
+        String c("hello");
+        c.reserve(100);
+        testExpect((void*)c.data() != (void*)&c);
+        testExpect(std::strlen(c.c_str()) == 5 && c == "hello");
+        c += " world";
+        testExpect(std::strlen(c.c_str()) == 11 && c == "hello world");
+    };
+    check(ist::compact_string<24>());
+    check(ist::compact_string<32>());
+
+    // compact strings are trivially relocatable. maps of them grow by realloc() and strings move with the element.
+    auto make_key = [](int i) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), i % 3 == 0 ? "%08d_long_key_stored_on_heap" : "%08d", i * 7919);
+        return ist::compact_string<>(buf);
+    };
+    ist::flat_map<ist::compact_string<>, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map[make_key(i)] = i;
+    }
+    testExpect(map.size() == 1000);
+    for (int i = 0; i < 1000; ++i) {
+        auto it = map.find(make_key(i));
+        testExpect(it != map.end() && it->second == i);
+    }
+}
+
+testCase(test_string_pool)
+{
+    ist::string_pool pool(256); // small blocks to cross block boundaries
+    std::vector<std::string> strs;
+    std::vector<ist::string_pool::id_type> ids;
+    for (int i = 0; i < 1000; ++i) {
+        strs.push_back("str" + std::to_string(i % 300) + std::string(i % 7 * 10, 'x'));
+        ids.push_back(pool.intern(strs.back()));
+    }
+    std::set<std::string> unique(strs.begin(), strs.end());
+    testExpect(pool.size() == unique.size());
+    for (size_t i = 0; i < strs.size(); ++i) {
+        // same string, same id. ids and strings are stable while the pool grows.
+        testExpect(pool.intern(strs[i]) == ids[i]);
+        testExpect(pool.find(strs[i]) == ids[i]);
+        testExpect(pool.view(ids[i]) == strs[i]);
+        testExpect(pool.c_str(ids[i])[strs[i].size()] == 0);
+        testExpect(pool.get(ids[i]) == strs[i].c_str());
+    }
+    testExpect(pool.find("not interned") == ist::string_pool::npos);
+    testExpect(pool.intern("") == pool.intern(std::string_view()));
+
+    // map keyed by ids, queried by strings
+    {
+        ist::string_pool_scope scope(pool);
+        ist::flat_map<ist::string_pool::id_type, int, ist::interned_less> map;
+        for (size_t i = 0; i < strs.size(); ++i) {
+            map[ids[i]] = (int)i;
+        }
+        testExpect(map.size() == unique.size());
+        for (size_t i = 0; i < strs.size(); ++i) {
+            auto it = map.find(std::string_view(strs[i]));
+            testExpect(it != map.end() && it->first == ids[i]);
+            testExpect(map.find(strs[i].c_str()) == it);
+            testExpect(map.lower_bound(strs[i]) == it);
+            testExpect(map.count(std::string_view(strs[i])) == 1);
+        }
+        testExpect(map.find("not interned") == map.end());
+        testExpect(map.count("not interned") == 0);
+
+        ist::flat_set<ist::string_pool::id_type, ist::interned_less> set(ids.begin(), ids.end());
+        testExpect(set.find(std::string_view(strs[0])) != set.end());
+        testExpect(set.find("not interned") == set.end());
+    }
+
+    pool.clear();
+    testExpect(pool.empty() && pool.find(strs[0]) == ist::string_pool::npos);
+    testExpect(pool.intern(strs[5]) == 0);
+}
+
+testCase(test_find_first_of)
+{
+    // compare with std::string on random strings. lengths cover SIMD blocks and tails.
+    std::mt19937 rand(3);
+    const char* sets[] = { " \t\r\n,;", "a", "", "0123456789abcdefXYZ!", "\x80\xff\x01 " };
+    for (int t = 0; t < 2000; ++t) {
+        size_t len = rand() % 100;
+        std::string sstr;
+        for (size_t i = 0; i < len; ++i) {
+            sstr += char(rand() % 4 == 0 ? " \t,\x80"[rand() % 4] : 'a' + rand() % 26);
+        }
+        ist::string istr = sstr;
+        for (auto set : sets) {
+            size_t pos = len ? rand() % (len + 1) : 0;
+            testExpect(istr.find_first_of(set, pos) == sstr.find_first_of(set, pos));
+            testExpect(istr.find_first_not_of(set, pos) == sstr.find_first_not_of(set, pos));
+
+            // find_last_of() family searches [pos, size())
+            size_t r1 = sstr.find_last_of(set);
+            testExpect(istr.find_last_of(set, pos) == (r1 != std::string::npos && r1 >= pos ? r1 : ist::string::npos));
+            size_t r2 = sstr.find_last_not_of(set);
+            testExpect(istr.find_last_not_of(set, pos) == (r2 != std::string::npos && r2 >= pos ? r2 : ist::string::npos));
+        }
+    }
+}
+
+testCase(test_find_substr)
+{
+    // compare with std::string on random strings. small alphabet makes many partial matches.
+    // needle lengths cover SIMD path and Horspool path.
+    std::mt19937 rand(5);
+    for (int t = 0; t < 3000; ++t) {
+        size_t len = rand() % 300;
+        std::string sstr;
+        for (size_t i = 0; i < len; ++i) {
+            sstr += char('a' + rand() % 3);
+        }
+        ist::string istr = sstr;
+
+        size_t nlen = rand() % 8 == 0 ? 65 + rand() % 40 : rand() % 8;
+        std::string needle;
+        if (len && rand() % 2) {
+            // substring of the haystack. always found.
+            size_t p = rand() % len;
+            needle = sstr.substr(p, nlen);
+        }
+        else {
+            for (size_t i = 0; i < nlen; ++i) {
+                needle += char('a' + rand() % 3);
+            }
+        }
+        size_t pos = rand() % (len + 2);
+        testExpect(istr.find(needle.c_str(), pos) == sstr.find(needle, pos));
+        testExpect(istr.find(std::string_view(needle)) == sstr.find(needle));
+
+        ist::string_searcher searcher(needle);
+        testExpect(searcher.find(sstr, pos) == sstr.find(needle, pos));
+        testExpect(searcher.find(istr) == sstr.find(needle));
+    }
+}
+
+testCase(test_linear_search)
+{
+    // lower_bound on small arithmetic keys takes SIMD linear scan path. compare with std::lower_bound.
+    auto check = [](auto tag) {
+        using T = decltype(tag);
+        for (int n = 0; n <= 70; ++n) {
+            std::vector<T> keys;
+            for (int i = 0; i < n; ++i) {
+                keys.push_back(std::is_signed_v<T> ? T(i * 2 - n) : T(i * 2));
+            }
+            ist::fixed_set<T, 70> fset(keys.begin(), keys.end());
+            ist::sbo_map<T, int, 16> bmap;
+            ist::split_map<T, int> smap;
+            for (auto k : keys) {
+                bmap[k] = int(k);
+                smap[k] = int(k);
+            }
+            for (int i = -n - 2; i <= n + 2; ++i) {
+                T v = T(i);
+                auto expected = std::lower_bound(keys.begin(), keys.end(), v) - keys.begin();
+                testExpect(ist::_linear_lower_bound(keys.data(), keys.size(), v) == size_t(expected));
+                testExpect(fset.lower_bound(v) - fset.begin() == expected);
+                testExpect(bmap.lower_bound(v) - bmap.begin() == expected);
+                testExpect(smap.lower_bound(v) - smap.begin() == expected);
+                testExpect(fset.count(v) == bmap.count(v));
+            }
+        }
+    };
+    check(int8_t());
+    check(int32_t());
+    check(uint32_t());
+    check(int64_t());
+    check(uint64_t());
+    check(float());
+    check(double());
+
+    // unsigned comparison must not be confused by sign bit
+    uint32_t ukeys[]{ 1, 2, 0x7fffffffu, 0x80000000u, 0xfffffffeu };
+    testExpect(ist::_linear_lower_bound(ukeys, 5, 0x80000000u) == 3);
+    testExpect(ist::_linear_lower_bound(ukeys, 5, 0xffffffffu) == 5);
+    uint64_t ukeys64[]{ 1, 2, 0x8000000000000000ull, 0xfffffffffffffffeull };
+    const uint64_t sign64 = 0x8000000000000000ull;
+    testExpect(ist::_linear_lower_bound(ukeys64, 4, sign64) == 2);
 }
@@ -0,0 +1,49 @@
+#include "Test.h"
+#include "flat_container/flat_set.h"
+#include "flat_container/flat_map.h"
+#include "flat_container/frozen_set.h"
+#include "flat_container/frozen_map.h"
+#include "flat_container/string.h"
+#include <map>
+#include <random>
+
+using test::Timer;
+using string = ist::string;
+
+
+testCase(test_frozen_map)
+{
+    for (int n : { 0, 1, 2, 3, 7, 8, 9, 100, 1000 }) {
+        std::vector<std::pair<const int, string>> src;
+        for (int i = n - 1; i >= 0; --i) {
+            src.push_back({ i * 2, string(std::to_string(i)) });
+        }
+
+        ist::flat_map<int, string> fmap(src.begin(), src.end());
+        ist::frozen_map<int, string> zmap(src.begin(), src.end());
+        ist::frozen_set<int> zset;
+        {
+            std::vector<int> keys;
+            for (auto& kvp : src) { keys.push_back(kvp.first); }
+            zset.assign(keys.begin(), keys.end());
+        }
+        testExpect(zmap.size() == fmap.size());
+        testExpect(zset.size() == fmap.size());
+        testExpect(std::equal(zmap.begin(), zmap.end(), fmap.begin()));
+
+        for (int k = -1; k <= n * 2; ++k) {
+            testExpect(zmap.lower_bound(k) == zmap.begin() + (fmap.lower_bound(k) - fmap.begin()));
+            testExpect(zmap.upper_bound(k) == zmap.begin() + (fmap.upper_bound(k) - fmap.begin()));
+            testExpect(zmap.count(k) == fmap.count(k));
+            testExpect(zset.count(k) == fmap.count(k));
+            if (auto it = zmap.find(k); it != zmap.end()) {
+                testExpect(it->second == fmap.at(k));
+            }
+        }
+    }
+
+    ist::frozen_set<string> sset{ "b", "a", "c", "a" };
+    testExpect(sset.size() == 3);
+    testExpect(sset.count(std::string_view("c")) == 1);
+    testExpect(sset.find("d") == sset.end());
+}
@@ -0,0 +1,161 @@
+#include "Test.h"
+#include "flat_container/flat_hash_map.h"
+#include "flat_container/flat_hash_set.h"
+#include "flat_container/string.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <random>
+
+using test::Timer;
+using string = ist::string;
+
+
+testCase(test_flat_hash_map)
+{
+    std::unordered_map<int, int> smap;
+    ist::flat_hash_map<int, int> fmap;
+    ist::fixed_hash_map<int, int, 300> xmap;
+    ist::sbo_hash_map<int, int, 32> bmap;
+
+    std::vector<std::byte> buf(ist::mapped_hash_map<int, int>::required_size(300));
+    ist::mapped_hash_map<int, int> vmap(buf.data(), buf.size());
+    testExpect(vmap.capacity() >= 300);
+    testExpect(xmap.capacity() >= 300);
+
+    auto check = [&]() {
+        testExpect(fmap.size() == smap.size());
+        testExpect(xmap.size() == smap.size());
+        testExpect(bmap.size() == smap.size());
+        testExpect(vmap.size() == smap.size());
+        testExpect((size_t)std::distance(fmap.begin(), fmap.end()) == smap.size());
+        testExpect((size_t)std::distance(xmap.begin(), xmap.end()) == smap.size());
+        for (auto& kvp : smap) {
+            testExpect(fmap.at(kvp.first) == kvp.second);
+            testExpect(xmap.at(kvp.first) == kvp.second);
+            testExpect(bmap.at(kvp.first) == kvp.second);
+            testExpect(vmap.at(kvp.first) == kvp.second);
+        }
+        for (auto& kvp : fmap) {
+            testExpect(smap.at(kvp.first) == kvp.second);
+        }
+    };
+
+    // random insert & erase. lots of erase makes tombstones and in-place rehash happen.
+    std::mt19937 rand(1);
+    for (int i = 0; i < 20000; ++i) {
+        int k = int(rand() % 600);
+        if (rand() % 2 == 0 && smap.size() < 300) {
+            smap[k] = i;
+            fmap[k] = i;
+            xmap[k] = i;
+            bmap[k] = i;
+            vmap[k] = i;
+        }
+        else {
+            smap.erase(k);
+            fmap.erase(k);
+            xmap.erase(k);
+            bmap.erase(k);
+            vmap.erase(k);
+        }
+        if (i % 1000 == 0) {
+            check();
+        }
+    }
+    check();
+    testExpect(fmap.count(-1) == 0);
+    testExpect(xmap.find(-1) == xmap.end());
+
+    // erase while iterating
+    for (auto it = fmap.begin(); it != fmap.end(); ) {
+        if (it->first % 2 == 0) {
+            it = fmap.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    for (auto& kvp : fmap) {
+        testExpect(kvp.first % 2 != 0);
+    }
+
+    // copy & move & swap
+    {
+        auto xmap2 = xmap;
+        testExpect(xmap2 == xmap);
+        auto bmap2 = std::move(bmap);
+        testExpect(bmap2.size() == smap.size() && bmap.empty());
+        bmap.swap(bmap2);
+        testExpect(bmap2.empty() && bmap.size() == smap.size());
+        ist::sbo_hash_map<int, int, 32> bmap3{ {1, 2}, {3, 4} };
+        bmap3.swap(bmap);
+        testExpect(bmap3.size() == smap.size() && bmap.size() == 2);
+    }
+
+    // fixed & mapped tables can be filled up to 100%, and throw if overflowed.
+    {
+        ist::fixed_hash_map<int, int, 10> tmap;
+        size_t n = tmap.capacity();
+        for (size_t i = 0; i < n; ++i) {
+            tmap[int(i)] = int(i);
+        }
+        testExpect(tmap.size() == n);
+        bool thrown = false;
+        try {
+            tmap[-1] = 0;
+        }
+        catch (const std::out_of_range&) {
+            thrown = true;
+        }
+        testExpect(thrown);
+        tmap.erase(0);
+        tmap[-1] = 0;
+        testExpect(tmap.at(-1) == 0 && tmap.size() == n);
+    }
+
+    // non-trivial elements
+    {
+        ist::flat_hash_map<string, string> map1{ {"abc", "1"}, {"def", "2"} };
+        map1.try_emplace("ghi", "3");
+        map1.emplace("jkl", "4");
+        map1.insert_or_assign("abc", "5");
+        testExpect(map1.size() == 4);
+        testExpect(map1.at("abc") == "5");
+        testExpect(map1.at("ghi") == "3");
+        testExpect(map1.at("jkl") == "4");
+        map1.erase("def");
+        testExpect(map1.size() == 3);
+        testExpect(map1.count("def") == 0);
+    }
+}
+
+testCase(test_flat_hash_set)
+{
+    std::unordered_set<uint64_t> sset;
+    ist::flat_hash_set<uint64_t> fset;
+    ist::fixed_hash_set<uint64_t, 100> xset;
+
+    std::mt19937_64 rand(2);
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t k = rand() % 200;
+        if (rand() % 2 == 0 && sset.size() < 100) {
+            testExpect(sset.insert(k).second == fset.insert(k).second);
+            xset.insert(k);
+        }
+        else {
+            sset.erase(k);
+            fset.erase(k);
+            xset.erase(k);
+        }
+    }
+    testExpect(fset.size() == sset.size());
+    testExpect(xset.size() == sset.size());
+    for (auto k : sset) {
+        testExpect(fset.contains(k));
+        testExpect(xset.count(k) == 1);
+    }
+
+    ist::flat_hash_set<string> strs{ "abc", "def", "abc" };
+    testExpect(strs.size() == 2);
+    testExpect(strs.contains("def"));
+}
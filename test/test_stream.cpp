@@ -5,6 +5,7 @@
 #include "flat_container/vector.h"
 #include "flat_container/string.h"
 #include "flat_container/memory_view_stream.h"
+#include "flat_container/snapshot.h"
 #include <set>
 #include <map>
 #include <memory>
@@ -49,3 +50,350 @@ testCase(test_memory_view_stream)
     ist::memory_view_stream stream2;
     std::swap(stream, stream2);
 }
+
+testCase(test_memory_view_stream_file)
+{
+    const char* path = "test_memory_view_stream.bin";
+    const size_t n = 1 << 20;
+    {
+        // the file is extended on overflow, and truncated to written size on close
+        ist::memory_view_stream stream;
+        testExpect(stream.open_file_for_write(path, 4096));
+        for (uint64_t i = 0; i < n; ++i) {
+            stream.write((char*)&i, sizeof(i));
+        }
+        testExpect(stream.good());
+    }
+    {
+        ist::memory_view_stream stream;
+        testExpect(stream.open_file(path));
+        testExpect(stream.size() == n * sizeof(uint64_t));
+        testExpect(((uint64_t*)stream.data())[n - 1] == n - 1); // mapped directly
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t t;
+            stream.read((char*)&t, sizeof(t));
+            testExpect(t == i);
+        }
+        uint64_t t;
+        stream.read((char*)&t, sizeof(t));
+        testExpect(stream.eof());
+
+        // read only
+        stream.clear();
+        stream.write((char*)&t, sizeof(t));
+        testExpect(stream.bad());
+        stream.close_file();
+        testExpect(!stream.is_file_open() && stream.size() == 0);
+    }
+    {
+        ist::memory_view_stream stream;
+        testExpect(!stream.open_file("nonexistent_file.bin"));
+        testExpect(stream.fail());
+    }
+    std::remove(path);
+}
+
+testCase(test_snapshot)
+{
+    // elements are written as raw bytes. types that hold pointers are rejected at compile time.
+    static_assert(ist::is_pointer_free_v<std::pair<int, double>>);
+    static_assert(!ist::is_pointer_free_v<std::pair<int, const char*>>);
+    static_assert(!ist::is_pointer_free_v<std::pair<ist::string, int>>);
+
+    ist::flat_map<int, double> map;
+    ist::flat_set<uint64_t> set;
+    for (int i = 0; i < 10000; ++i) {
+        map[i * 3] = i * 0.5;
+        set.insert(uint64_t(i) * 7);
+    }
+
+    // write via stream
+    ist::raw_vector<char> buf;
+    ist::memory_view_stream stream(buf.data(), buf.size());
+    stream.set_overflow_handler([&buf](char*& data, size_t& size) -> bool {
+        buf.resize(std::max<size_t>(1024, size * 2));
+        data = buf.data();
+        size = buf.size();
+        return true;
+        });
+    testExpect(ist::write_snapshot(map, stream));
+    buf.resize(ist::snapshot_size(map));
+
+    {
+        auto view = ist::load_snapshot<ist::mapped_map<int, double>>(buf.data(), buf.size());
+        testExpect(view.size() == map.size());
+        testExpect(view.get().data() == (void*)(buf.data() + sizeof(ist::snapshot_header))); // zero copy
+        testExpect(view.at(300) == 50.0);
+        testExpect(view.find(301) == view.end());
+        testExpect(view == map);
+    }
+
+    // write to memory
+    ist::raw_vector<char> buf2(ist::snapshot_size(set));
+    testExpect(ist::write_snapshot(set, buf2.data(), buf2.size()) == buf2.size());
+    testExpect(ist::write_snapshot(set, buf2.data(), buf2.size() - 1) == 0);
+    {
+        auto view = ist::load_snapshot<ist::mapped_set<uint64_t>>(buf2.data(), buf2.size());
+        testExpect(view == set);
+    }
+
+    auto expect_invalid = [](auto tag, ist::raw_vector<char>& data) {
+        using mapped_t = decltype(tag);
+        bool thrown = false;
+        try {
+            mapped_t view = ist::load_snapshot<mapped_t>(data.data(), data.size());
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        return thrown;
+    };
+    testExpect(expect_invalid(ist::mapped_map<int, float>(), buf)); // element type mismatch
+    buf2.resize(buf2.size() - 8);
+    testExpect(expect_invalid(ist::mapped_set<uint64_t>(), buf2)); // truncated
+    buf[100] ^= 1;
+    testExpect(expect_invalid(ist::mapped_map<int, double>(), buf)); // corrupted
+}
+
+testCase(test_memory_view_reader)
+{
+    // over plain buffer
+    {
+        char buf[64];
+        ist::memory_view_writer writer(buf, sizeof(buf));
+        testExpect(writer.write(uint32_t(1)));
+        testExpect(writer.write(2.0));
+        testExpect(writer.write_varint(uint64_t(300)));
+        testExpect(writer.write_varint(int64_t(-5)));
+        testExpect(writer.write_varint(~uint64_t(0)));
+        int arr[3] = { 7, 8, 9 };
+        testExpect(writer.write_span(arr, 3) == 3);
+        testExpect(writer.remaining() == 64 - (4 + 8 + 2 + 1 + 10 + 12));
+        char big[64]{};
+        testExpect(writer.write_bytes(big, sizeof(big)) != sizeof(big) && writer.full());
+
+        ist::memory_view_reader reader(buf, sizeof(buf));
+        uint32_t u32;
+        testExpect(reader.peek(u32) && u32 == 1);
+        testExpect(reader.read<uint32_t>() == 1);
+        testExpect(reader.read<double>() == 2.0);
+        uint64_t u64;
+        int64_t i64;
+        testExpect(reader.read_varint(u64) && u64 == 300);
+        testExpect(reader.read_varint(i64) && i64 == -5);
+        testExpect(reader.read_varint(u64) && u64 == ~uint64_t(0));
+        int arr2[3];
+        testExpect(reader.read_span(arr2, 3) == 3 && arr2[2] == 9);
+        testExpect(reader.skip(reader.remaining()));
+        testExpect(!reader.read(u32) && reader.eof());
+    }
+
+    // over memory_view_stream. handlers are called at buffer boundaries.
+    {
+        ist::vector<char> cont;
+        ist::memory_view_stream stream(cont.data(), cont.size());
+        stream.set_overflow_handler([&cont](char*& data, size_t& size) -> bool {
+            cont.resize(std::max<size_t>(32, size * 2));
+            data = cont.data();
+            size = cont.size();
+            return true;
+            });
+        {
+            ist::memory_view_writer writer(stream);
+            for (uint64_t i = 0; i < 1000; ++i) {
+                writer.write_varint(i * 1000);
+                writer.write(uint8_t(i));
+            }
+        }
+        uint64_t tail = 12345;
+        stream.write((char*)&tail, sizeof(tail)); // continues from the writer's position
+
+        // read in chunks of 100 bytes through underflow handler
+        size_t pos = 0;
+        ist::memory_view_stream rstream(cont.data(), std::min<size_t>(100, cont.size()));
+        rstream.set_underflow_handler([&cont, &pos](char*& data, size_t& size, char*& cur) -> bool {
+            pos += size;
+            if (pos >= cont.size()) {
+                return false;
+            }
+            data = cont.data() + pos;
+            size = std::min<size_t>(100, cont.size() - pos);
+            cur = data;
+            return true;
+            });
+        {
+            ist::memory_view_reader reader(rstream);
+            for (uint64_t i = 0; i < 1000; ++i) {
+                uint64_t v;
+                testExpect(reader.read_varint(v) && v == i * 1000);
+                testExpect(reader.read<uint8_t>() == uint8_t(i));
+            }
+        }
+        uint64_t t;
+        rstream.read((char*)&t, sizeof(t));
+        testExpect(t == 12345);
+    }
+}
+
+testCase(test_async_prefetch)
+{
+    // values straddle buffer boundaries (buffer size is not a multiple of 8)
+    const uint64_t n = 100000;
+    auto make_source = [n]() {
+        return [n, pos = uint64_t(0)](char* dst, size_t size) mutable -> size_t {
+            size_t total = n * sizeof(uint64_t);
+            size_t r = std::min(size, total - pos);
+            for (size_t i = 0; i < r; ++i, ++pos) {
+                uint64_t v = pos / sizeof(uint64_t);
+                dst[i] = ((char*)&v)[pos % sizeof(uint64_t)];
+            }
+            return r;
+        };
+    };
+
+    for (size_t num_buffers : { 2, 4 }) {
+        ist::memory_view_stream stream;
+        stream.start_async_read(make_source(), 1000, num_buffers);
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t t;
+            stream.read((char*)&t, sizeof(t));
+            testExpect(t == i);
+        }
+        uint64_t t;
+        stream.read((char*)&t, sizeof(t));
+        testExpect(stream.eof());
+    }
+    {
+        // with memory_view_reader
+        ist::memory_view_stream stream;
+        stream.start_async_read(make_source(), 4096);
+        ist::memory_view_reader reader(stream);
+        for (uint64_t i = 0; i < n; ++i) {
+            testExpect(reader.read<uint64_t>() == i);
+        }
+        testExpect(reader.read<uint64_t>() == 0 && reader.eof());
+    }
+    {
+        // stop before the end
+        ist::memory_view_stream stream;
+        stream.start_async_read(make_source(), 1000);
+        uint64_t t;
+        stream.read((char*)&t, sizeof(t));
+        stream.stop_async_read();
+    }
+    {
+        // errors of the source are not silent EOF
+        auto failing_source = [pos = size_t(0)](char* dst, size_t size) mutable -> size_t {
+            if (pos >= 3000) {
+                throw std::runtime_error("read error");
+            }
+            std::memset(dst, 0, size);
+            pos += size;
+            return size;
+        };
+        ist::memory_view_stream stream;
+        stream.exceptions(std::ios::badbit);
+        stream.start_async_read(failing_source, 1000);
+        std::vector<char> buf(3000);
+        stream.read(buf.data(), buf.size());
+        bool thrown = false;
+        try {
+            stream.read(buf.data(), 1);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        testExpect(thrown);
+    }
+}
+
+testCase(test_flush_write)
+{
+    const uint64_t n = 100000;
+    auto write_all = [n](ist::memory_view_stream& stream) {
+        ist::memory_view_writer writer(stream);
+        for (uint64_t i = 0; i < n; ++i) {
+            writer.write(i);
+            if (i % 1000 == 0) {
+                writer.write(uint8_t(0xff)); // makes values straddle chunk boundaries
+            }
+        }
+    };
+    auto verify = [n](const std::vector<char>& data) {
+        ist::memory_view_reader reader(data.data(), data.size());
+        for (uint64_t i = 0; i < n; ++i) {
+            testExpect(reader.read<uint64_t>() == i);
+            if (i % 1000 == 0) {
+                testExpect(reader.read<uint8_t>() == 0xff);
+            }
+        }
+        testExpect(reader.remaining() == 0);
+    };
+
+    // callback. memory usage is constant.
+    for (size_t batch : { 1, 3 }) {
+        std::vector<char> out;
+        size_t num_calls = 0, max_chunks = 0;
+        {
+            ist::memory_view_stream stream;
+            stream.start_flush_write([&](const ist::memory_view_chunk* chunks, size_t num_chunks) {
+                ++num_calls;
+                max_chunks = std::max(max_chunks, num_chunks);
+                for (size_t i = 0; i < num_chunks; ++i) {
+                    testExpect(chunks[i].size <= 4096);
+                    out.insert(out.end(), chunks[i].data, chunks[i].data + chunks[i].size);
+                }
+                return true;
+                }, 4096, batch);
+            write_all(stream);
+            testExpect(stream.size() == 4096);
+        } // remaining data is flushed on destruction
+        testExpect(max_chunks == batch);
+        testExpect(num_calls >= (n * 8) / (4096 * batch));
+        verify(out);
+    }
+
+#if !defined(_WIN32)
+    // fd (writev)
+    {
+        const char* path = "test_flush_write.bin";
+        int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        testExpect(fd >= 0);
+        {
+            ist::memory_view_stream stream;
+            stream.start_flush_write(ist::make_fd_flush_handler(fd), 4096, 8);
+            write_all(stream);
+            stream.flush();
+            testExpect(stream.good());
+        }
+        ::close(fd);
+
+        ist::mapped_file file;
+        testExpect(file.open(path));
+        verify(std::vector<char>((char*)file.data(), (char*)file.data() + file.size()));
+        file.close();
+        std::remove(path);
+    }
+#endif
+
+    // lock-free queue consumed by another thread
+    {
+        ist::chunk_queue queue(4096, 4);
+        std::vector<char> out;
+        std::thread consumer([&]() {
+            ist::memory_view_chunk c;
+            while (queue.wait_front(c)) {
+                out.insert(out.end(), c.data, c.data + c.size);
+                queue.pop();
+            }
+            });
+        {
+            ist::memory_view_stream stream;
+            stream.start_flush_write(queue.handler(), 4096);
+            write_all(stream);
+        }
+        queue.close();
+        consumer.join();
+        verify(out);
+    }
+}